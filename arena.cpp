@@ -0,0 +1,138 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <cstdlib>
+#include "uthreads.h"
+#include "uthreads_internal.h"
+#include "arena.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define HEADER_SIZE ((sizeof (ArenaChunk) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+#define ALLOC_ERR "Arena error, size is 0 or alignment isn't a power of two!"
+#define ARENA_TID_ERR "Arena error, illegal tid!"
+#define ARENA_BAD_ALLOC_ERR "bad alloc"
+
+/** freeChunks - standard chunks released by terminated threads, shared by all arenas */
+static ArenaChunk *freeChunks = nullptr;
+static int freeChunkCount = 0;
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+takeChunk - gets a chunk of at least size bytes, header included: a standard
+ chunk from the shared free list if one is free, or a new one otherwise.
+ Called with the timer signal blocked.
+@param size: the size needed
+@return the chunk
+*/
+static ArenaChunk *takeChunk (size_t size)
+{
+  if (size <= ARENA_CHUNK_SIZE && freeChunks != nullptr)
+  {
+    ArenaChunk *chunk = freeChunks;
+    freeChunks = chunk->next;
+    freeChunkCount--;
+    return chunk;
+  }
+  size_t chunk_size = size <= ARENA_CHUNK_SIZE ? ARENA_CHUNK_SIZE : size;
+  ArenaChunk *chunk = (ArenaChunk *) malloc (chunk_size);
+  if (chunk == nullptr)
+  {
+    err_sys_print (ARENA_BAD_ALLOC_ERR);
+  }
+  chunk->size = chunk_size;
+  return chunk;
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Arena Class ~~~~~~~~~~~ **/
+
+Arena::Arena ()
+{
+  this->chunks = nullptr;
+  this->cur = nullptr;
+  this->end = nullptr;
+}
+
+Arena::~Arena ()
+{
+  release ();
+}
+
+void *Arena::refill (size_t size, size_t align)
+{
+  // The shared free list is reached with the timer blocked; the bump itself
+  // needs no protection, since only the owning thread allocates. A caller
+  // inside a blocked region keeps its mask.
+  bool wasBlocked = signalsBlocked ();
+  block_signals_helper ();
+  ArenaChunk *chunk = takeChunk (HEADER_SIZE + size + align - 1);
+  if (!wasBlocked)
+  {
+    unblock_signals_helper ();
+  }
+  chunk->next = chunks;
+  chunks = chunk;
+  cur = (char *) chunk + HEADER_SIZE;
+  end = (char *) chunk + chunk->size;
+  return allocate (size, align);
+}
+
+void Arena::release ()
+{
+  while (chunks != nullptr)
+  {
+    ArenaChunk *chunk = chunks;
+    chunks = chunk->next;
+    if (chunk->size == ARENA_CHUNK_SIZE && freeChunkCount < ARENA_FREE_CHUNKS_MAX)
+    {
+      chunk->next = freeChunks;
+      freeChunks = chunk;
+      freeChunkCount++;
+    }
+    else
+    {
+      free (chunk);
+    }
+  }
+  cur = nullptr;
+  end = nullptr;
+}
+
+int Arena::chunkCount ()
+{
+  int count = 0;
+  for (ArenaChunk *chunk = chunks; chunk != nullptr; chunk = chunk->next)
+  {
+    count++;
+  }
+  return count;
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+void *uthread_alloc (size_t size)
+{
+  return uthread_alloc_aligned (size, ARENA_ALIGN);
+}
+
+void *uthread_alloc_aligned (size_t size, size_t alignment)
+{
+  if (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+  {
+    err_lib_print (ALLOC_ERR);
+    return nullptr;
+  }
+  return threadArena (uthread_get_tid ())->allocate (size, alignment);
+}
+
+int uthread_arena_chunks (int tid)
+{
+  block_signals_helper ();
+  Arena *arena = uthread_scheduler::validTid (tid) ? threadArena (tid) : nullptr;
+  int count = arena != nullptr ? arena->chunkCount () : FAILURE;
+  unblock_signals_helper ();
+  if (count == FAILURE)
+  {
+    err_lib_print (ARENA_TID_ERR);
+  }
+  return count;
+}
@@ -0,0 +1,141 @@
+/*
+ * Per-thread arena allocator for uthreads.
+ *
+ * Every thread owns an arena: a list of chunks it allocates from by bumping a pointer, without locking, since no
+ * other thread allocates from it. Memory isn't freed one object at a time; all of a thread's chunks go back to a
+ * shared free list in one step when the thread is terminated, so a killed thread leaks nothing and releasing costs
+ * O(chunks) instead of O(objects). Fresh chunks are taken from the free list before falling back to malloc.
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define ARENA_CHUNK_SIZE 65536 /* size of a standard arena chunk (in bytes) */
+#define ARENA_FREE_CHUNKS_MAX 256 /* maximal number of standard chunks kept on the shared free list */
+#define ARENA_ALIGN 16 /* alignment of uthread_alloc */
+
+/** ArenaChunk - the header at the start of every chunk */
+struct ArenaChunk
+{
+  ArenaChunk *next;       // The next chunk of the arena, or of the free list
+  size_t size;            // The size of the chunk in bytes, header included
+};
+
+/**
+ * An Arena hands out memory from its chunks by bumping a pointer. It is owned by a single thread.
+ */
+class Arena
+{
+ private:
+  ArenaChunk *chunks;     // The chunks of the arena, the current one first
+  char *cur;              // The first free byte of the current chunk
+  char *end;              // The end of the current chunk
+
+  /**
+   * Adds a chunk with room for size bytes aligned to align, and allocates from it.
+   */
+  void *refill (size_t size, size_t align);
+
+ public:
+  Arena ();
+
+  /**
+   * Releases all the chunks.
+   */
+  ~Arena ();
+
+  Arena (const Arena &) = delete;
+  Arena &operator= (const Arena &) = delete;
+
+  /**
+   * Allocates size bytes aligned to align, a power of two.
+   *
+   * @return The allocated memory.
+   */
+  void *allocate (size_t size, size_t align)
+  {
+    uintptr_t p = ((uintptr_t) cur + align - 1) & ~(uintptr_t) (align - 1);
+    if (cur != nullptr && p + size <= (uintptr_t) end)
+    {
+      cur = (char *) (p + size);
+      return (void *) p;
+    }
+    return refill (size, align);
+  }
+
+  /**
+   * Returns all the chunks at once: standard chunks to the shared free list, larger ones to the system. Must be
+   * called with the timer signal blocked.
+   */
+  void release ();
+
+  /**
+   * @return The number of chunks the arena holds.
+   */
+  int chunkCount ();
+};
+
+/* External interface */
+
+/**
+ * @brief Allocates size bytes, aligned to ARENA_ALIGN, from the arena of the RUNNING thread.
+ *
+ * The memory can't be freed on its own: it stays valid until the thread that allocated it terminates, and is then
+ * released together with all the thread's other allocations. It must not be used after that.
+ *
+ * @return On success, return the allocated memory. On failure (size is 0), return nullptr.
+*/
+void *uthread_alloc (size_t size);
+
+/**
+ * @brief Allocates size bytes aligned to alignment, a power of two, from the arena of the RUNNING thread, as
+ * uthread_alloc does.
+ *
+ * @return On success, return the allocated memory. On failure, return nullptr.
+*/
+void *uthread_alloc_aligned (size_t size, size_t alignment);
+
+/**
+ * @brief Returns the number of chunks held by the arena of the thread with ID tid.
+ *
+ * @return On success, return the number of chunks. On failure, return -1.
+*/
+int uthread_arena_chunks (int tid);
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+
+/**
+ * A std::pmr::memory_resource over uthread_alloc, so pmr containers can allocate from the arena of the thread that
+ * uses them. Deallocation does nothing; the memory is released when the allocating thread terminates.
+ */
+class uthread_memory_resource : public std::pmr::memory_resource
+{
+ protected:
+  void *do_allocate (size_t bytes, size_t alignment) override
+  {
+    void *memory = uthread_alloc_aligned (bytes != 0 ? bytes : 1, alignment);
+    if (memory == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+    return memory;
+  }
+
+  void do_deallocate (void *, size_t, size_t) override
+  {}
+
+  bool do_is_equal (const std::pmr::memory_resource &other) const noexcept override
+  {
+    // Every instance allocates from the same per-thread arenas.
+    return dynamic_cast<const uthread_memory_resource *> (&other) != nullptr;
+  }
+};
+#endif
+
+#endif
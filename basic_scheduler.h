@@ -0,0 +1,141 @@
+/*
+ * Compile-time configuration of the uthreads scheduler.
+ *
+ * basic_scheduler<Config> holds the scheduler's thread table and pool of free thread IDs, and gives the per-thread
+ * tables of uthreads.cpp their type, sized and switched by the constexpr members of Config, so their capacities are
+ * known at compile time and they live in std::arrays instead of growing containers. Features that Config turns off
+ * are guarded by constant conditions the compiler drops. The uthread_* API uses the instantiation for
+ * default_scheduler_config, whose values are the MAX_THREAD_NUM and STACK_SIZE of uthreads.h.
+ *
+ * The scheduling queues, groups, timers and posted calls stay in uthreads.cpp and aren't parameterized, and threads'
+ * control blocks and stacks are still allocated as they are spawned.
+ */
+
+#ifndef _BASIC_SCHEDULER_H
+#define _BASIC_SCHEDULER_H
+
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include "uthreads.h"
+#include "thread.h"
+#include "trace.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+/**
+ * The configuration of the uthread_* API. A configuration is any type with the same constexpr members.
+ */
+struct default_scheduler_config
+{
+  static constexpr int max_threads = MAX_THREAD_NUM;        // The size of the thread table, main thread included
+  static constexpr int stack_size = STACK_SIZE;             // The stack size of uthread_spawn, in bytes
+  static constexpr bool stats = true;                       // Whether CPU time is measured at every switch
+  static constexpr bool trace = true;                       // Whether the trace hooks are compiled in
+  static constexpr int run_next_limit = 3;                  // Consecutive picks the run-next slot may win, 0 for none
+  static constexpr int shared_stack_size = 1 << 20;         // The stack of uthread_spawn_shared threads, in bytes
+};
+
+/**
+ * The fixed-size state of a scheduler configured by Config: the thread table, the pool of free thread IDs, and
+ * per-thread tables for the modules built on the scheduler.
+ */
+template <class Config>
+class basic_scheduler
+{
+  static_assert (Config::max_threads > 0, "the thread table must hold the main thread");
+  static_assert (Config::stack_size > 0 && Config::stack_size % 16 == 0,
+                 "the stack size must be a positive multiple of 16");
+  static_assert (Config::run_next_limit >= 0, "the run-next limit can't be negative");
+  static_assert (Config::shared_stack_size >= Config::stack_size && Config::shared_stack_size % 16 == 0,
+                 "the shared stack must be a multiple of 16, at least the stack size");
+
+ public:
+  static constexpr int max_threads = Config::max_threads;
+  static constexpr int dispatcher_tid = Config::max_threads;  // The library's dispatcher, past the IDs handed out
+  static constexpr int table_size = Config::max_threads + 1;  // The thread IDs, the dispatcher's included
+  static constexpr int stack_size = Config::stack_size;
+  static constexpr bool stats = Config::stats;
+  static constexpr int run_next_limit = Config::run_next_limit;
+  static constexpr int shared_stack_size = Config::shared_stack_size;
+
+  /** thread_table - one T per thread ID, the dispatcher's included */
+  template <class T>
+  using thread_table = std::array<T, Config::max_threads + 1>;
+
+  thread_table<std::shared_ptr<Thread>> threads;   // The threads, indexed by ID, nullptr for free IDs
+
+  basic_scheduler ()
+  {
+    for (int i = 0; i < max_threads; i++)
+    {
+      freeIds[i] = i;
+    }
+    freeCount = max_threads;
+  }
+
+  /**
+   * @return Whether tid is one of the IDs handed out to threads, which leave out the dispatcher's.
+   */
+  static constexpr bool validTid (int tid)
+  {
+    return tid >= 0 && tid < max_threads;
+  }
+
+  /**
+   * @return Whether all the thread IDs are taken.
+   */
+  bool full () const
+  {
+    return freeCount == 0;
+  }
+
+  /**
+   * Takes the smallest free thread ID. The table must not be full.
+   *
+   * @return The ID.
+   */
+  int takeId ()
+  {
+    // freeIds[0, freeCount) is a min-heap.
+    std::pop_heap (freeIds.begin (), freeIds.begin () + freeCount, std::greater<int> ());
+    return freeIds[--freeCount];
+  }
+
+  /**
+   * Returns a thread ID to the pool of free IDs.
+   */
+  void releaseId (int tid)
+  {
+    freeIds[freeCount++] = tid;
+    std::push_heap (freeIds.begin (), freeIds.begin () + freeCount, std::greater<int> ());
+  }
+
+  /**
+   * Records a trace event, unless tracing is compiled out.
+   */
+  static void trace (TraceEventType type, int tid, TraceReason reason = TRACE_NO_REASON)
+  {
+    if (Config::trace)
+    {
+      traceEvent (type, tid, reason);
+    }
+  }
+
+ private:
+  std::array<int, Config::max_threads> freeIds;    // The free thread IDs, as a min-heap
+  int freeCount;                                   // The number of free thread IDs
+};
+
+// The constexpr members are odr-used (bound to references by std::make_shared and std::min), so before C++17 they
+// need a definition in one translation unit; as members of a template, they get it here.
+template <class Config> constexpr int basic_scheduler<Config>::max_threads;
+template <class Config> constexpr int basic_scheduler<Config>::dispatcher_tid;
+template <class Config> constexpr int basic_scheduler<Config>::table_size;
+template <class Config> constexpr int basic_scheduler<Config>::stack_size;
+template <class Config> constexpr bool basic_scheduler<Config>::stats;
+template <class Config> constexpr int basic_scheduler<Config>::run_next_limit;
+template <class Config> constexpr int basic_scheduler<Config>::shared_stack_size;
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Shared-stack threads against dedicated stacks: the cost of a uthread_yield_to
+ * ping-pong switch, and the memory an idle thread keeps while it is blocked
+ * some frames deep.
+ *
+ * Usage: shared_stack_bench switch
+ *        shared_stack_bench idle <dedicated|shared> <depth>
+ * Each idle figure runs in a process of its own, so the heap isn't reused
+ * from an earlier measurement.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "uthreads.h"
+
+#define SWITCHES 200000
+#define IDLE_THREADS 90
+#define FRAME_BYTES 200
+#define DEDICATED_STACK_SIZE 65536 /* a stack deep enough for the idle threads and a signal frame */
+
+static volatile int finished = 0;
+static int peers[2];
+static volatile int blocked = 0;
+static int depth = 0;
+static bool shared = false;
+
+/**
+nowNsecs - reads the monotonic clock
+@return the time in nanoseconds
+*/
+static long nowNsecs ()
+{
+  timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+vmBytes - reads the size of the address space of the process
+@return the size in bytes
+*/
+static long vmBytes ()
+{
+  long pages = 0;
+  FILE *statm = fopen ("/proc/self/statm", "r");
+  if (statm == nullptr || fscanf (statm, "%ld", &pages) != 1)
+  {
+    fprintf (stderr, "can't read /proc/self/statm\n");
+    exit (1);
+  }
+  fclose (statm);
+  return pages * 4096;
+}
+
+static int spawn (thread_entry_point entry_point)
+{
+  return shared ? uthread_spawn_shared (entry_point)
+                : uthread_spawn_with_stack (entry_point, DEDICATED_STACK_SIZE);
+}
+
+static void pinger ()
+{
+  int self = uthread_get_tid () == peers[0] ? 0 : 1;
+  for (int i = 0; i < SWITCHES; i++)
+  {
+    uthread_yield_to (peers[1 - self]);
+  }
+  // The peer's last switches come here, so wait for it to finish too.
+  finished++;
+  while (finished < 2)
+  {
+    uthread_yield ();
+  }
+  uthread_terminate (uthread_get_tid ());
+}
+
+/**
+switchNsecs - runs a ping-pong between two threads of the current kind
+@return the time per switch in nanoseconds
+*/
+static double switchNsecs ()
+{
+  finished = 0;
+  peers[0] = spawn (pinger);
+  peers[1] = spawn (pinger);
+  long start = nowNsecs ();
+  while (finished < 2)
+  {
+    uthread_yield ();
+  }
+  return (double) (nowNsecs () - start) / (2.0 * SWITCHES);
+}
+
+/**
+descend - recurses count frames of FRAME_BYTES, then blocks the running thread
+@return a value depending on the frames, so they aren't optimized away
+*/
+static int descend (int count)
+{
+  volatile char frame[FRAME_BYTES];
+  memset ((char *) frame, count, sizeof (frame));
+  if (count > 0)
+  {
+    return descend (count - 1) + frame[0];
+  }
+  blocked++;
+  uthread_block (uthread_get_tid ());
+  return frame[0];
+}
+
+static void idler ()
+{
+  descend (depth);
+}
+
+static void exiter ()
+{
+  uthread_terminate (uthread_get_tid ());
+}
+
+/**
+idleBytes - spawns IDLE_THREADS threads of the current kind that block depth
+ frames deep
+@return the address space they keep, per thread, in bytes
+*/
+static long idleBytes ()
+{
+  // A first thread allocates the shared stack, which isn't counted.
+  spawn (exiter);
+  uthread_yield ();
+  long before = vmBytes ();
+  for (int i = 0; i < IDLE_THREADS; i++)
+  {
+    spawn (idler);
+  }
+  while (blocked < IDLE_THREADS)
+  {
+    uthread_yield ();
+  }
+  // The last idle thread keeps its frames on the shared stack until another
+  // shared thread runs there.
+  spawn (exiter);
+  uthread_yield ();
+  return (vmBytes () - before) / IDLE_THREADS;
+}
+
+int main (int argc, char *argv[])
+{
+  bool idle = argc == 4 && strcmp (argv[1], "idle") == 0;
+  if (!(argc == 2 && strcmp (argv[1], "switch") == 0) && !idle)
+  {
+    fprintf (stderr, "usage: %s switch | idle <dedicated|shared> <depth>\n", argv[0]);
+    return 1;
+  }
+  uthread_init (100000);
+  if (idle)
+  {
+    shared = strcmp (argv[2], "shared") == 0;
+    depth = atoi (argv[3]);
+    printf ("idle %-9s %2d frames deep: %6ld bytes per thread\n", argv[2], depth, idleBytes ());
+  }
+  else
+  {
+    printf ("switch dedicated: %6.0f ns\n", switchNsecs ());
+    shared = true;
+    printf ("switch shared:    %6.0f ns\n", switchNsecs ());
+  }
+  uthread_terminate (0);
+}
@@ -0,0 +1,97 @@
+#include "index_heap.h"
+
+/** ~~~~~~~~~~~~~~~~~~ IndexHeap Class ~~~~~~~~~~~ **/
+
+IndexHeap::IndexHeap (int capacity)
+{
+  reserve (capacity);
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Methods ~~~~~~~~~~~ **/
+
+void IndexHeap::place (int index, const std::pair<long, int>& entry)
+{
+  heap[index] = entry;
+  slots[entry.second] = index;
+}
+
+void IndexHeap::sift (int index)
+{
+  std::pair<long, int> entry = heap[index];
+  while (index > 0 && entry < heap[(index - 1) / 2])
+  {
+    place (index, heap[(index - 1) / 2]);
+    index = (index - 1) / 2;
+  }
+  int size = (int) heap.size ();
+  for (;;)
+  {
+    int child = 2 * index + 1;
+    if (child >= size)
+    { break; }
+    if (child + 1 < size && heap[child + 1] < heap[child])
+    {
+      child++;
+    }
+    if (!(heap[child] < entry))
+    { break; }
+    place (index, heap[child]);
+    index = child;
+  }
+  place (index, entry);
+}
+
+void IndexHeap::reserve (int capacity)
+{
+  if (capacity > (int) slots.size ())
+  {
+    slots.resize (capacity, -1);
+    heap.reserve (capacity);
+  }
+}
+
+bool IndexHeap::empty () const
+{
+  return heap.empty ();
+}
+
+bool IndexHeap::contains (int id) const
+{
+  return slots[id] != -1;
+}
+
+int IndexHeap::top () const
+{
+  return heap.front ().second;
+}
+
+long IndexHeap::topKey () const
+{
+  return heap.front ().first;
+}
+
+void IndexHeap::push (int id, long key)
+{
+  heap.push_back ({key, id});
+  sift ((int) heap.size () - 1);
+}
+
+void IndexHeap::pop ()
+{
+  erase (top ());
+}
+
+void IndexHeap::erase (int id)
+{
+  int index = slots[id];
+  if (index == -1)
+  { return; }
+  slots[id] = -1;
+  std::pair<long, int> last = heap.back ();
+  heap.pop_back ();
+  if (index < (int) heap.size ())
+  {
+    place (index, last);
+    sift (index);
+  }
+}
@@ -0,0 +1,95 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+
+#ifndef _INDEX_HEAP_H
+#define _INDEX_HEAP_H
+
+#include <vector>
+#include <utility>
+
+/**
+ * The IndexHeap class is a binary min-heap of IDs by key, ordered by key and then by ID, that holds each ID in
+ * [0, capacity) at most once and knows where every ID is. Pushing, popping and erasing any ID take O(log n).
+ * Storage is sized by the capacity, so within it the heap never allocates, and scheduling points can use it.
+ */
+class IndexHeap
+{
+ private:
+  std::vector<std::pair<long, int>> heap;    // The (key, ID) entries in heap order
+  std::vector<int> slots;                    // The index of each ID in heap, or -1 if the ID isn't in the heap
+
+  /**
+   * Stores an entry at an index of the heap.
+   */
+  void place (int index, const std::pair<long, int>& entry);
+
+  /**
+   * Moves the entry at an index up or down until the heap is ordered again.
+   */
+  void sift (int index);
+
+ public:
+  /**
+   * Constructs an empty heap with room for the IDs in [0, capacity).
+   *
+   * @param capacity The number of IDs.
+   */
+  explicit IndexHeap(int capacity = 0);
+
+  /**
+   * Makes room for the IDs in [0, capacity). Allocates, unlike the other methods.
+   *
+   * @param capacity The number of IDs.
+   */
+  void reserve(int capacity);
+
+  /**
+   * Determines whether the heap holds no IDs.
+   *
+   * @return True if the heap is empty, false otherwise.
+   */
+  bool empty() const;
+
+  /**
+   * Determines whether an ID is in the heap.
+   *
+   * @param id An ID below the capacity.
+   * @return True if the ID is in the heap, false otherwise.
+   */
+  bool contains(int id) const;
+
+  /**
+   * Returns the ID with the smallest key. The heap must not be empty.
+   *
+   * @return The ID.
+   */
+  int top() const;
+
+  /**
+   * Returns the smallest key. The heap must not be empty.
+   *
+   * @return The key.
+   */
+  long topKey() const;
+
+  /**
+   * Adds an ID that isn't in the heap.
+   *
+   * @param id An ID below the capacity.
+   * @param key The key of the ID.
+   */
+  void push(int id, long key);
+
+  /**
+   * Removes the ID with the smallest key. The heap must not be empty.
+   */
+  void pop();
+
+  /**
+   * Removes an ID, if it is in the heap.
+   *
+   * @param id An ID below the capacity.
+   */
+  void erase(int id);
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Lock-free multi-producer/single-consumer queue.
+ *
+ * Any number of OS threads may push concurrently; a single consumer pops. Pushing is one atomic exchange and never
+ * blocks, so it is safe to call from threads the uthreads library knows nothing about.
+ */
+
+#ifndef _MPSC_QUEUE_H
+#define _MPSC_QUEUE_H
+
+#include <atomic>
+
+/**
+ * An intrusive MPSC queue in the style of Vyukov: producers exchange themselves into head, the consumer walks the
+ * list from tail. A stub node keeps the list non-empty, so head and tail never race on the same pointer.
+ * T must be default-constructible and copyable.
+ */
+template <typename T>
+class MpscQueue
+{
+ private:
+  struct Node
+  {
+    std::atomic<Node *> next;
+    T value;
+  };
+
+  std::atomic<Node *> head;   // The most recently pushed node, written by the producers
+  Node *tail;                 // The oldest node not yet popped, owned by the consumer
+  Node stub;                  // Placeholder node that never carries a value
+
+  /**
+   * Links node after the current head.
+   */
+  void link (Node *node)
+  {
+    node->next.store (nullptr, std::memory_order_relaxed);
+    Node *prev = head.exchange (node, std::memory_order_acq_rel);
+    prev->next.store (node, std::memory_order_release);
+  }
+
+ public:
+  MpscQueue () : head (&stub), tail (&stub)
+  {
+    stub.next.store (nullptr, std::memory_order_relaxed);
+  }
+
+  ~MpscQueue ()
+  {
+    T value;
+    while (pop (value))
+    {}
+  }
+
+  MpscQueue (const MpscQueue &) = delete;
+  MpscQueue &operator= (const MpscQueue &) = delete;
+
+  /**
+   * Pushes a value. May be called from any thread.
+   *
+   * @param value The value to push.
+   */
+  void push (const T &value)
+  {
+    Node *node = new Node;
+    node->value = value;
+    link (node);
+  }
+
+  /**
+   * Pops the oldest value. Must only be called by the consumer.
+   *
+   * @param value Set to the popped value on success.
+   * @return True if a value was popped, false if the queue is empty or a producer is in the middle of a push.
+   */
+  bool pop (T &value)
+  {
+    Node *node = tail;
+    Node *next = node->next.load (std::memory_order_acquire);
+    if (node == &stub)
+    {
+      if (next == nullptr)
+      { return false; }
+      tail = next;
+      node = next;
+      next = next->next.load (std::memory_order_acquire);
+    }
+    if (next == nullptr)
+    {
+      if (node != head.load (std::memory_order_acquire))
+      { return false; }
+      // node is the last one; put the stub behind it so it can be unlinked.
+      link (&stub);
+      next = node->next.load (std::memory_order_acquire);
+      if (next == nullptr)
+      { return false; }
+    }
+    tail = next;
+    value = node->value;
+    delete node;
+    return true;
+  }
+
+  /**
+   * Checks whether the queue holds no values. Must only be called by the consumer.
+   *
+   * @return True if the queue is empty, false otherwise (including while a producer is in the middle of a push).
+   */
+  bool empty ()
+  {
+    return tail == &stub && head.load (std::memory_order_seq_cst) == &stub;
+  }
+};
+
+#endif
@@ -0,0 +1,194 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include "uthreads_internal.h"
+#include "profiler.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define SUCCESS 0
+#define PROFILER_START_ERR "Profiler error, number of samples isn't positive!"
+
+#ifdef __x86_64__
+#define UC_PC REG_RIP
+#define UC_FP REG_RBP
+#else
+#define UC_PC REG_EIP
+#define UC_FP REG_EBP
+#endif
+
+/** Sample - one tick of a thread: its PC followed by the return addresses of its callers */
+struct Sample
+{
+  int tid;
+  int depth;
+  uintptr_t pcs[PROFILER_MAX_DEPTH];
+};
+
+/** samples - the preallocated sample buffer */
+static std::vector<Sample> samples;
+
+/** sampleCount - the number of samples taken, may exceed the buffer size */
+static std::atomic<long> sampleCount (0);
+
+/** profilerOn - whether the timer handler records samples */
+static std::atomic<bool> profilerOn (false);
+
+/** osStackLow, osStackHigh - bounds of the OS thread's stack, used by the main thread */
+static char *osStackLow = nullptr;
+static char *osStackHigh = nullptr;
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+osStackBounds - finds the bounds of the calling OS thread's stack
+@return void
+*/
+static void osStackBounds ()
+{
+  pthread_attr_t attr;
+  void *addr;
+  size_t size;
+  if (pthread_getattr_np (pthread_self (), &attr) != 0)
+  { return; }
+  if (pthread_attr_getstack (&attr, &addr, &size) == 0)
+  {
+    osStackLow = (char *) addr;
+    osStackHigh = (char *) addr + size;
+  }
+  pthread_attr_destroy (&attr);
+}
+
+/**
+frameName - resolves a code address to a demangled function name
+@param pc: the address to resolve
+@return the function name, or the address in hex if it has no symbol
+*/
+static std::string frameName (uintptr_t pc)
+{
+  Dl_info info;
+  if (dladdr ((void *) pc, &info) != 0 && info.dli_sname != nullptr)
+  {
+    int status;
+    char *demangled = abi::__cxa_demangle (info.dli_sname, nullptr, nullptr,
+                                           &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    free (demangled);
+    return name;
+  }
+  std::ostringstream hex;
+  hex << "0x" << std::hex << pc;
+  return hex.str ();
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+void profilerSample (int tid, void *ucontext, char *stack_low, char *stack_high)
+{
+  if (!profilerOn.load (std::memory_order_relaxed))
+  { return; }
+  long index = sampleCount.fetch_add (1, std::memory_order_relaxed);
+  if (index >= (long) samples.size ())
+  { return; }
+
+  Sample &sample = samples[index];
+  const greg_t *regs = ((ucontext_t *) ucontext)->uc_mcontext.gregs;
+  sample.tid = tid;
+  sample.pcs[0] = (uintptr_t) regs[UC_PC];
+  sample.depth = 1;
+  if (stack_low == nullptr)
+  {
+    stack_low = osStackLow;
+    stack_high = osStackHigh;
+  }
+
+  // Each frame holds the caller's frame pointer followed by the return address.
+  uintptr_t *fp = (uintptr_t *) regs[UC_FP];
+  while (sample.depth < PROFILER_MAX_DEPTH
+         && (char *) fp >= stack_low && (char *) (fp + 2) <= stack_high
+         && (uintptr_t) fp % sizeof (uintptr_t) == 0)
+  {
+    uintptr_t ret = fp[1];
+    if (ret == 0)
+    { break; }
+    // Return addresses point after the call, so step back into it.
+    sample.pcs[sample.depth++] = ret - 1;
+    uintptr_t *next = (uintptr_t *) fp[0];
+    if (next <= fp)
+    { break; }
+    fp = next;
+  }
+}
+
+int uthread_profiler_start (int max_samples)
+{
+  if (max_samples <= 0)
+  {
+    err_lib_print (PROFILER_START_ERR);
+    return FAILURE;
+  }
+  block_signals_helper ();
+  profilerOn.store (false);
+  samples.assign (max_samples, Sample ());
+  sampleCount.store (0);
+  if (osStackLow == nullptr)
+  {
+    osStackBounds ();
+  }
+  profilerOn.store (true);
+  unblock_signals_helper ();
+  return SUCCESS;
+}
+
+void uthread_profiler_stop ()
+{
+  profilerOn.store (false);
+}
+
+long uthread_profiler_dropped ()
+{
+  long taken = sampleCount.load ();
+  return taken > (long) samples.size () ? taken - (long) samples.size () : 0;
+}
+
+int uthread_profiler_write_collapsed (std::ostream &out)
+{
+  // Copied with the timer blocked, so no sample is written meanwhile.
+  block_signals_helper ();
+  long count = sampleCount.load ();
+  if (count > (long) samples.size ())
+  { count = (long) samples.size (); }
+  std::vector<Sample> taken (samples.begin (), samples.begin () + count);
+  unblock_signals_helper ();
+
+  std::map<std::string, int> stacks;
+  std::map<uintptr_t, std::string> names;
+  for (const Sample &sample : taken)
+  {
+    std::string stack = "uthread_" + std::to_string (sample.tid);
+    for (int i = sample.depth - 1; i >= 0; i--)
+    {
+      auto name = names.find (sample.pcs[i]);
+      if (name == names.end ())
+      {
+        name = names.insert ({sample.pcs[i], frameName (sample.pcs[i])}).first;
+      }
+      stack += ";" + name->second;
+    }
+    stacks[stack]++;
+  }
+  for (auto &stack : stacks)
+  {
+    out << stack.first << ' ' << stack.second << '\n';
+  }
+  return (int) count;
+}
@@ -0,0 +1,58 @@
+/*
+ * Sampling profiler for uthreads.
+ *
+ * While profiling, every timer tick records the interrupted PC of the running thread together with its caller chain,
+ * found by walking the frame pointers of the thread's own stack. Samples go into a buffer allocated up front, so the
+ * signal handler never allocates, and are aggregated per thread when exported.
+ * Frame-pointer unwinding needs the profiled code to keep its frame pointers (-fno-omit-frame-pointer when
+ * optimizing); function names are resolved with dladdr, so executables should be linked with -rdynamic.
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <ostream>
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define PROFILER_MAX_DEPTH 32 /* maximal number of frames recorded per sample */
+
+/* External interface */
+
+/**
+ * @brief Starts sampling, with room for max_samples samples. Samples taken once the buffer is full are dropped.
+ * Any previous samples are discarded.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_profiler_start (int max_samples);
+
+/**
+ * @brief Stops sampling. The samples taken so far are kept until the next uthread_profiler_start.
+*/
+void uthread_profiler_stop ();
+
+/**
+ * @brief Writes the samples as collapsed stacks, the input format of flamegraph.pl: one line per distinct stack,
+ * "uthread_<tid>;<outermost frame>;...;<innermost frame> <count>". The thread is the root frame, so every thread
+ * gets its own tower in the flame graph.
+ *
+ * @return The number of samples written.
+*/
+int uthread_profiler_write_collapsed (std::ostream &out);
+
+/**
+ * @return The number of samples dropped because the buffer was full.
+*/
+long uthread_profiler_dropped ();
+
+/* Hook for the scheduler */
+
+/**
+ * @brief Records one sample of the thread with ID tid, interrupted with the context in ucontext, if profiling is on.
+ * Called from the timer signal handler. stack_low and stack_high bound the thread's stack; frames outside of them
+ * end the walk.
+*/
+void profilerSample (int tid, void *ucontext, char *stack_low, char *stack_high);
+
+#endif
@@ -0,0 +1,87 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <functional>
+#include "uthreads.h"
+#include "uthreads_internal.h"
+#include "scope.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define NO_GROUP -1
+
+/** bodies - the function each scope thread runs, set before the thread first runs */
+static std::function<void ()> bodies[MAX_THREAD_NUM];
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+scopeThread - the entry point of every scope thread: runs its body, then
+ terminates it. The library frees the thread's stack and arena once it has
+ switched off them, so a finished scope thread leaves nothing behind.
+@return never returns
+*/
+static void scopeThread ()
+{
+  int tid = uthread_get_tid ();
+  {
+    // Destroyed before terminating, which doesn't return.
+    std::function<void ()> body;
+    block_signals_helper ();
+    body.swap (bodies[tid]);
+    unblock_signals_helper ();
+    body ();
+    // Its captures may be on the heap, so they're freed with the timer blocked.
+    block_signals_helper ();
+    body = nullptr;
+  }
+  uthread_terminate (tid);
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Scope Class ~~~~~~~~~~~ **/
+
+Scope::Scope () : gid (uthread_group_create ()), is_cancelled (false)
+{}
+
+Scope::~Scope ()
+{
+  if (gid == NO_GROUP)
+  { return; }
+  join ();
+  uthread_group_terminate (gid);
+}
+
+int Scope::spawn (std::function<void ()> body)
+{
+  if (gid == NO_GROUP)
+  { return FAILURE; }
+  // The thread can't run before its body is in place.
+  block_signals_helper ();
+  int tid = spawnThread (scopeThread, SCOPE_STACK_SIZE, gid);
+  if (tid != FAILURE)
+  {
+    bodies[tid].swap (body);
+  }
+  // Left unused if the spawn failed; freed like the ones scopeThread runs.
+  body = nullptr;
+  unblock_signals_helper ();
+  return tid;
+}
+
+void Scope::cancel ()
+{
+  if (gid == NO_GROUP)
+  { return; }
+  is_cancelled = true;
+  uthread_group_cancel (gid);
+}
+
+bool Scope::cancelled () const
+{
+  return is_cancelled;
+}
+
+int Scope::join ()
+{
+  if (gid == NO_GROUP)
+  { return FAILURE; }
+  return uthread_group_wait (gid);
+}
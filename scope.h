@@ -0,0 +1,69 @@
+/*
+ * Structured concurrency scopes on top of the uthreads library.
+ *
+ * A Scope owns the threads spawned into it: destroying the scope waits for all of them, so none outlives the block
+ * that created it. Cancelling the scope cancels its threads, which makes their blocking operations fail with
+ * ECANCELED (see uthread_cancel), so they unwind promptly and release their resources on the way out.
+ */
+
+#ifndef _SCOPE_H
+#define _SCOPE_H
+
+#include <functional>
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define SCOPE_STACK_SIZE 65536 /* stack size per scope thread (in bytes) */
+
+/**
+ * A Scope is a thread group whose threads are joined when the scope is destroyed.
+ */
+class Scope
+{
+ private:
+  int gid;                // The ID of the scope's thread group, or -1 if it couldn't be created
+  bool is_cancelled;      // Whether cancel was called
+
+ public:
+  /**
+   * Creates the scope's thread group. Takes one of the MAX_GROUP_NUM groups until the scope is destroyed.
+   */
+  Scope ();
+
+  /**
+   * Waits for the threads of the scope, as join does, and deletes its group.
+   */
+  ~Scope ();
+
+  Scope (const Scope &) = delete;
+  Scope &operator= (const Scope &) = delete;
+
+  /**
+   * Spawns a thread that runs body and then terminates, with a stack of SCOPE_STACK_SIZE bytes. The thread may also
+   * terminate itself early. A thread spawned into a cancelled scope starts cancelled. Its stack and arena are freed
+   * as it terminates, so a long-lived program may keep creating scopes.
+   *
+   * @return On success, the ID of the new thread. On failure, -1.
+   */
+  int spawn (std::function<void ()> body);
+
+  /**
+   * Cancels every thread of the scope, and the threads spawned into it later. Doesn't wait for them.
+   */
+  void cancel ();
+
+  /**
+   * @return True if the scope was cancelled, false otherwise.
+   */
+  bool cancelled () const;
+
+  /**
+   * Blocks the calling thread until all the threads of the scope terminated. The wait isn't interrupted if the
+   * calling thread is cancelled. The threads of a scope can't join it.
+   *
+   * @return On success, 0. On failure, -1.
+   */
+  int join ();
+};
+
+#endif
@@ -0,0 +1,449 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <deque>
+#include <vector>
+#include <string>
+#include "uthreads.h"
+#include "uthreads_internal.h"
+#include "taskpool.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define SUCCESS 0
+#define NO_WAITER -1
+#define POOL_INIT_ERR "Task pool error, invalid number of workers or already initialized!"
+#define POOL_SHUTDOWN_ERR "Task pool error, not initialized or tasks still pending!"
+
+/** Task - a job spawned into a task group. A range task has no fn and runs
+ body over [begin, end) instead, so splitting a range builds no std::function. */
+struct Task
+{
+  std::function<void ()> fn;
+  TaskGroup *group;
+  const range_body *body;
+  long begin;
+  long end;
+  long grain;
+};
+
+/** Worker - a worker thread and its deque of tasks */
+struct Worker
+{
+  int tid;
+  bool idle;
+  std::deque<Task *> tasks;
+};
+
+/** workers - the workers of the pool, sized once by taskpool_init */
+static std::vector<Worker> workers;
+
+/** workerByTid - maps a thread ID to its worker, nullptr for non-worker threads */
+static Worker *workerByTid[MAX_THREAD_NUM] = {};
+
+/** registeredWorkers - the number of workers that already claimed their slot */
+static int registeredWorkers = 0;
+
+/** nextVictim - round-robin cursor for pushing from non-workers and for stealing */
+static unsigned long nextVictim = 0;
+
+/** ~~~~~~~~~~~~~~~~~~ TaskGroup Class ~~~~~~~~~~~ **/
+
+TaskGroup::TaskGroup () : pending (0), waiter (NO_WAITER)
+{}
+
+void TaskGroup::taskAdded ()
+{
+  block_signals_helper ();
+  pending++;
+  unblock_signals_helper ();
+}
+
+void TaskGroup::taskDone ()
+{
+  block_signals_helper ();
+  pending--;
+  if (pending == 0 && waiter != NO_WAITER)
+  {
+    int tid = waiter;
+    waiter = NO_WAITER;
+    resumeBlocked (tid);
+  }
+  unblock_signals_helper ();
+}
+
+bool TaskGroup::isDone ()
+{
+  return pending == 0;
+}
+
+void TaskGroup::setWaiter (int tid)
+{
+  waiter = tid;
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+currentWorker - gets the worker of the calling thread
+@return the calling thread's worker, or nullptr if it isn't a worker
+*/
+static Worker *currentWorker ()
+{
+  int tid = uthread_get_tid ();
+  // Posted calls run on the dispatcher, whose ID is past the user's threads.
+  return uthread_scheduler::validTid (tid) ? workerByTid[tid] : nullptr;
+}
+
+/**
+hasQueuedTasks - checks whether any worker has a task waiting in its deque.
+ Must be called with the timer signal blocked.
+@return true if some deque is non-empty, false otherwise
+*/
+static bool hasQueuedTasks ()
+{
+  for (Worker &worker : workers)
+  {
+    if (!worker.tasks.empty ())
+    { return true; }
+  }
+  return false;
+}
+
+/**
+pushTask - pushes a task to the calling worker's deque, or to the next worker in
+ round-robin order, and wakes up one idle worker to steal it
+@param task: the task to push
+@return void
+*/
+static void pushTask (Task *task)
+{
+  block_signals_helper ();
+  Worker *self = currentWorker ();
+  if (self == nullptr)
+  {
+    self = &workers[nextVictim++ % workers.size ()];
+  }
+  self->tasks.push_back (task);
+  for (Worker &worker : workers)
+  {
+    if (worker.idle)
+    {
+      worker.idle = false;
+      resumeBlocked (worker.tid);
+      break;
+    }
+  }
+  unblock_signals_helper ();
+}
+
+/**
+popOwnTask - takes the newest task of the calling worker, without stealing
+@param self: the calling thread's worker
+@return the task to run, or nullptr if the worker's deque is empty
+*/
+static Task *popOwnTask (Worker *self)
+{
+  Task *task = nullptr;
+  block_signals_helper ();
+  if (!self->tasks.empty ())
+  {
+    task = self->tasks.back ();
+    self->tasks.pop_back ();
+  }
+  unblock_signals_helper ();
+  return task;
+}
+
+/**
+popTask - takes the newest task of the calling worker, or steals the oldest task
+ of another worker when the own deque is empty
+@param self: the calling thread's worker, or nullptr for a non-worker thread
+@return the task to run, or nullptr if there is none
+*/
+static Task *popTask (Worker *self)
+{
+  Task *task = nullptr;
+  if (self != nullptr)
+  {
+    task = popOwnTask (self);
+    if (task != nullptr)
+    { return task; }
+  }
+  block_signals_helper ();
+  unsigned long start = nextVictim++;
+  for (unsigned long i = 0; i < workers.size (); i++)
+  {
+    Worker &victim = workers[(start + i) % workers.size ()];
+    if (!victim.tasks.empty ())
+    {
+      task = victim.tasks.front ();
+      victim.tasks.pop_front ();
+      break;
+    }
+  }
+  unblock_signals_helper ();
+  return task;
+}
+
+static void runRange (TaskGroup &group, long begin, long end, long grain,
+                      const range_body &body);
+
+/**
+runTask - runs a task and reports its completion to its group
+@param task: the task to run, freed afterwards
+@return void
+*/
+static void runTask (Task *task)
+{
+  if (task->body != nullptr)
+  {
+    runRange (*task->group, task->begin, task->end, task->grain, *task->body);
+  }
+  else
+  {
+    task->fn ();
+  }
+  TaskGroup *group = task->group;
+  // Like the allocation in task_spawn, freed with the timer blocked.
+  block_signals_helper ();
+  delete task;
+  unblock_signals_helper ();
+  group->taskDone ();
+}
+
+/**
+shouldSplit - decides whether the executing thread should split its range further.
+ A worker splits while its deque is empty, i.e. while nothing can be stolen from
+ it; other threads split while some worker is idle.
+@return true if the range should be split, false otherwise
+*/
+static bool shouldSplit ()
+{
+  Worker *self = currentWorker ();
+  if (self != nullptr)
+  {
+    return self->tasks.empty ();
+  }
+  for (Worker &worker : workers)
+  {
+    if (worker.idle || worker.tasks.empty ())
+    { return true; }
+  }
+  return false;
+}
+
+/**
+spawnRange - spawns a range task running body over [begin, end) into group
+@return void
+*/
+static void spawnRange (TaskGroup &group, long begin, long end, long grain,
+                        const range_body &body)
+{
+  group.taskAdded ();
+  // Allocated with the timer blocked, like the tasks of task_spawn.
+  block_signals_helper ();
+  pushTask (new Task {nullptr, &group, &body, begin, end, grain});
+}
+
+/**
+runRange - runs body over [begin, end) in chunks of grain, handing off the upper
+ half of the remaining range as a new task whenever shouldSplit asks for it
+@return void
+*/
+static void runRange (TaskGroup &group, long begin, long end, long grain,
+                      const range_body &body)
+{
+  while (end - begin > grain)
+  {
+    if (shouldSplit ())
+    {
+      long mid = begin + (end - begin) / 2;
+      spawnRange (group, mid, end, grain, body);
+      end = mid;
+    }
+    else
+    {
+      body (begin, begin + grain);
+      begin += grain;
+    }
+  }
+  body (begin, end);
+}
+
+/**
+workerLoop - the entry point of the worker threads. Runs tasks while there are
+ any, and blocks until pushTask wakes it up otherwise.
+@return void
+*/
+static void workerLoop ()
+{
+  int tid = uthread_get_tid ();
+  block_signals_helper ();
+  Worker *self = &workers[registeredWorkers++];
+  self->tid = tid;
+  workerByTid[tid] = self;
+  unblock_signals_helper ();
+
+  for (;;)
+  {
+    Task *task = popTask (self);
+    if (task != nullptr)
+    {
+      runTask (task);
+      continue;
+    }
+    block_signals_helper ();
+    if (!hasQueuedTasks ())
+    {
+      self->idle = true;
+      blockRunning ();
+    }
+    unblock_signals_helper ();
+  }
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+int taskpool_init (int num_workers)
+{
+  if (num_workers <= 0 || num_workers > TASK_POOL_MAX_WORKERS
+      || !workers.empty ())
+  {
+    err_lib_print (POOL_INIT_ERR);
+    return FAILURE;
+  }
+  // Sized up front: the workers keep pointers into the vector.
+  workers.resize (num_workers);
+  for (Worker &worker : workers)
+  {
+    worker.tid = -1;
+    worker.idle = false;
+  }
+  for (int i = 0; i < num_workers; i++)
+  {
+    if (uthread_spawn_with_stack (workerLoop, TASK_WORKER_STACK_SIZE) == FAILURE)
+    {
+      // Workers that were spawned but didn't run yet never claim a slot.
+      workers.resize (i);
+      taskpool_shutdown ();
+      return FAILURE;
+    }
+  }
+  return SUCCESS;
+}
+
+int taskpool_shutdown ()
+{
+  block_signals_helper ();
+  if (workers.empty () || hasQueuedTasks ())
+  {
+    unblock_signals_helper ();
+    err_lib_print (POOL_SHUTDOWN_ERR);
+    return FAILURE;
+  }
+  std::vector<int> tids;
+  for (Worker &worker : workers)
+  {
+    if (worker.tid != -1)
+    {
+      workerByTid[worker.tid] = nullptr;
+      tids.push_back (worker.tid);
+    }
+  }
+  workers.clear ();
+  registeredWorkers = 0;
+  unblock_signals_helper ();
+  for (int tid : tids)
+  {
+    uthread_terminate (tid);
+  }
+  return SUCCESS;
+}
+
+void task_spawn (TaskGroup &group, std::function<void ()> fn)
+{
+  if (workers.empty ())
+  {
+    fn ();
+    return;
+  }
+  group.taskAdded ();
+  // malloc isn't reentrant: a thread preempted inside it must not be followed
+  // by another thread allocating on the same OS thread. pushTask re-enables the
+  // timer.
+  block_signals_helper ();
+  pushTask (new Task {std::move (fn), &group, nullptr, 0, 0, 0});
+}
+
+void task_sync (TaskGroup &group)
+{
+  Worker *self = currentWorker ();
+  int tid = uthread_get_tid ();
+  while (!group.isDone ())
+  {
+    // Stolen tasks nest on the waiter's stack without bound, so only the main
+    // thread, which runs on the process stack, steals while waiting. Workers
+    // only run their own tasks, which are children of the ones on their stack.
+    Task *task = nullptr;
+    if (tid == 0)
+    { task = popTask (self); }
+    else if (self != nullptr)
+    { task = popOwnTask (self); }
+    if (task != nullptr)
+    {
+      runTask (task);
+      continue;
+    }
+    // The remaining tasks already run on other workers. The main thread can't
+    // block, so it lets them run and polls again.
+    if (tid == 0)
+    {
+      uthread_yield ();
+      continue;
+    }
+    block_signals_helper ();
+    if (!group.isDone ())
+    {
+      group.setWaiter (tid);
+      blockRunning ();
+    }
+    unblock_signals_helper ();
+  }
+}
+
+void parallel_for_range (long begin, long end, long grain, const range_body &body)
+{
+  if (end <= begin)
+  { return; }
+  if (workers.empty ())
+  {
+    body (begin, end);
+    return;
+  }
+  if (grain <= 0)
+  {
+    grain = (end - begin) / ((long) workers.size () * TASK_SPLIT_FACTOR);
+    if (grain < 1)
+    { grain = 1; }
+  }
+  TaskGroup group;
+  runRange (group, begin, end, grain, body);
+  task_sync (group);
+}
+
+void parallel_for (long begin, long end, long grain, const std::function<void (long)> &fn)
+{
+  parallel_for_range (begin, end, grain, [&fn] (long b, long e)
+  {
+    for (long i = b; i < e; i++)
+    {
+      fn (i);
+    }
+  });
+}
+
+void taskpool_exclusive (const std::function<void ()> &fn)
+{
+  block_signals_helper ();
+  fn ();
+  unblock_signals_helper ();
+}
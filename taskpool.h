@@ -0,0 +1,137 @@
+/*
+ * Task pool on top of the uthreads library.
+ *
+ * Tasks are lightweight jobs that run on a small fixed set of worker uthreads instead of one uthread per task.
+ * Every worker owns a deque of tasks: it pushes and pops its own tasks at the back, and idle workers steal the
+ * oldest (largest) tasks from the front of the other workers' deques.
+ */
+
+#ifndef _TASKPOOL_H
+#define _TASKPOOL_H
+
+#include <functional>
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define TASK_POOL_MAX_WORKERS 16 /* maximal number of worker threads */
+#define TASK_WORKER_STACK_SIZE 65536 /* stack size per worker thread (in bytes) */
+#define TASK_SPLIT_FACTOR 8 /* automatic grain aims for this many chunks per worker */
+
+typedef std::function<void (long, long)> range_body;
+
+/**
+ * A TaskGroup tracks the tasks spawned into it, so that task_sync can wait until all of them finished.
+ */
+class TaskGroup
+{
+ private:
+  int pending;            // The number of tasks spawned into the group that didn't finish yet
+  int waiter;             // The ID of the thread blocked in task_sync, or -1
+
+ public:
+  TaskGroup ();
+
+  /**
+   * Registers a newly spawned task in the group.
+   */
+  void taskAdded ();
+
+  /**
+   * Marks one task of the group as finished, resuming the waiting thread if it was the last one.
+   */
+  void taskDone ();
+
+  /**
+   * @return True if all the tasks spawned into the group finished, false otherwise.
+   */
+  bool isDone ();
+
+  /**
+   * Sets the thread that should be resumed when the last task of the group finishes.
+   *
+   * @param tid The ID of the waiting thread.
+   */
+  void setWaiter (int tid);
+};
+
+/* External interface */
+
+/**
+ * @brief Starts the task pool with num_workers worker threads.
+ *
+ * Must be called after uthread_init. Each worker takes one slot of the thread table and a stack of
+ * TASK_WORKER_STACK_SIZE bytes.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int taskpool_init (int num_workers);
+
+/**
+ * @brief Terminates the worker threads. All the task groups must be synced before calling this function.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int taskpool_shutdown ();
+
+/**
+ * @brief Spawns fn as a task of group. The task is pushed to the calling worker's deque (or to a worker's deque in
+ * round-robin order when called from a non-worker thread), and an idle worker is woken up to steal it.
+ * If the pool wasn't initialized, fn runs immediately on the calling thread.
+*/
+void task_spawn (TaskGroup &group, std::function<void ()> fn);
+
+/**
+ * @brief Waits until all the tasks of group finished. While waiting, the calling thread runs pending tasks itself;
+ * it blocks only when the remaining tasks are already running on other workers. Only the main thread steals
+ * from other workers while waiting; the other threads run just their own tasks, which bounds their stack depth.
+*/
+void task_sync (TaskGroup &group);
+
+/**
+ * @brief Runs body on subranges covering [begin, end) and returns once all of them finished.
+ *
+ * Ranges are split lazily: a range longer than grain is halved only while the executing worker has nothing that
+ * could be stolen from it, so the number of tasks adapts to how busy the workers are. A non-positive grain picks one
+ * automatically from the range length and the number of workers.
+*/
+void parallel_for_range (long begin, long end, long grain, const range_body &body);
+
+/**
+ * @brief Calls fn(i) for every i in [begin, end), split into tasks as in parallel_for_range.
+*/
+void parallel_for (long begin, long end, long grain, const std::function<void (long)> &fn);
+
+/**
+ * @brief Runs fn with the timer signal blocked, so it can't interleave with other threads.
+*/
+void taskpool_exclusive (const std::function<void ()> &fn);
+
+/**
+ * @brief Reduces [begin, end) in parallel.
+ *
+ * fn(b, e, identity) computes the partial result of the subrange [b, e), and the partial results are merged with
+ * combine, which must be associative and commutative.
+ *
+ * @return The combined result, or identity for an empty range.
+*/
+template <typename T, typename RangeFn, typename CombineFn>
+T parallel_reduce (long begin, long end, long grain, T identity, RangeFn fn, CombineFn combine)
+{
+  // The lambdas capture no more than two references, so the std::functions
+  // they're passed as keep them inline instead of allocating with the timer on.
+  struct
+  {
+    T result;
+    const T &identity;
+    RangeFn &fn;
+    CombineFn &combine;
+  } state = {identity, identity, fn, combine};
+  parallel_for_range (begin, end, grain, [&state] (long b, long e)
+  {
+    T part = state.fn (b, e, state.identity);
+    taskpool_exclusive ([&state, &part] { state.result = state.combine (state.result, part); });
+  });
+  return state.result;
+}
+
+#endif
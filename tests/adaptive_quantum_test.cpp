@@ -0,0 +1,49 @@
+/*
+ * Adaptive quantum: the default quantum shrinks as READY threads are added, to
+ * keep their wait near the delay target, stays within its bounds, and is
+ * restored when tuning is turned off.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define SPINNERS 20
+
+static volatile long spins = 0;
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (10000) == 0);
+  CHECK (uthread_get_quantum_usecs () == 10000);
+  CHECK (uthread_set_adaptive_quantum (0, 1000, 10, 0) == -1);
+  CHECK (uthread_set_adaptive_quantum (2000, 1000, 10, 0) == -1);
+  CHECK (uthread_set_adaptive_quantum (1000, 50000, 0, 0) == -1);
+  CHECK (uthread_set_adaptive_quantum (1000, 50000, 1001, 0) == -1);
+  CHECK (uthread_set_adaptive_quantum (1000, 50000, 10, -1) == -1);
+
+  // Without a delay target the quantum grows to its maximum.
+  CHECK (uthread_set_adaptive_quantum (1000, 30000, 10, 0) == 0);
+  uthread_spawn (spinner);
+  CHECK (runUntil ([] { return uthread_get_quantum_usecs () == 30000; }));
+
+  CHECK (uthread_set_adaptive_quantum (1000, 50000, 10, 40000) == 0);
+  for (int i = 1; i < SPINNERS; i++)
+  {
+    uthread_spawn (spinner);
+  }
+  CHECK (runUntil ([] { return uthread_get_quantum_usecs () <= 40000 / SPINNERS * 2; }));
+  CHECK (uthread_get_quantum_usecs () >= 1000);
+
+  CHECK (uthread_set_adaptive_quantum (0, 0, 0, 0) == 0);
+  CHECK (uthread_get_quantum_usecs () == 10000);
+  printf ("adaptive_quantum_test: ok\n");
+  uthread_terminate (0);
+}
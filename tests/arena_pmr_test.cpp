@@ -0,0 +1,57 @@
+/*
+ * The std::pmr adaptor of the arenas: a pmr vector grows inside the arena of
+ * the thread that fills it, and its memory goes back with the thread's chunks.
+ */
+
+#include <memory_resource>
+#include <vector>
+#include "uthreads.h"
+#include "arena.h"
+#include "check.h"
+
+#define COUNT 100000
+
+static volatile bool filled = false;
+static volatile long sum = 0;
+static volatile int chunksBefore = 0;
+
+static void filler ()
+{
+  chunksBefore = uthread_arena_chunks (uthread_get_tid ());
+  uthread_memory_resource resource;
+  std::pmr::vector<long> values (&resource);
+  for (long i = 0; i < COUNT; i++)
+  {
+    values.push_back (i);
+  }
+  long total = 0;
+  for (long value : values)
+  {
+    total += value;
+  }
+  sum = total;
+  filled = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  uthread_memory_resource a;
+  uthread_memory_resource b;
+  CHECK (a.is_equal (b));
+  CHECK (!a.is_equal (*std::pmr::new_delete_resource ()));
+
+  int tid = uthread_spawn_with_stack (filler, 65536);
+  CHECK (runUntil ([] { return filled; }));
+  CHECK (sum == (long) COUNT * (COUNT - 1) / 2);
+  // Past ARENA_CHUNK_SIZE, every doubling of the vector takes a chunk of its own.
+  CHECK (uthread_arena_chunks (tid) - chunksBefore >= 4);
+  uthread_terminate (tid);
+  CHECK (uthread_arena_chunks (tid) == -1);
+  printf ("arena_pmr_test: ok\n");
+  uthread_terminate (0);
+}
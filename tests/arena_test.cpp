@@ -0,0 +1,90 @@
+/*
+ * Per-thread arenas: allocations are aligned and grow the arena by chunks, a
+ * terminated thread's chunks are reused by the next thread, growing the arena
+ * inside a blocked region keeps the timer blocked, and threads that terminate
+ * themselves don't leak their stacks or arenas.
+ */
+
+#include <cstdint>
+#include <signal.h>
+#include "uthreads.h"
+#include "arena.h"
+#include "taskpool.h"
+#include "check.h"
+
+#define SELF_TERMINATED 20000
+
+static void *volatile small = nullptr;
+static void *volatile aligned = nullptr;
+static void *volatile large = nullptr;
+static volatile bool allocated = false;
+static volatile int exited = 0;
+
+static void allocator ()
+{
+  small = uthread_alloc (100);
+  aligned = uthread_alloc_aligned (64, 256);
+  large = uthread_alloc (2 * ARENA_CHUNK_SIZE);
+  allocated = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+static void exiter ()
+{
+  uthread_alloc (100);
+  exited++;
+  uthread_terminate (uthread_get_tid ());
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  int tid = uthread_spawn (allocator);
+  CHECK (runUntil ([] { return allocated; }));
+  CHECK (small != nullptr && (uintptr_t) small % ARENA_ALIGN == 0);
+  CHECK (aligned != nullptr && (uintptr_t) aligned % 256 == 0);
+  CHECK (large != nullptr);
+  CHECK (uthread_arena_chunks (tid) == 2);
+  CHECK (uthread_alloc (0) == nullptr);
+  CHECK (uthread_alloc_aligned (8, 3) == nullptr);
+
+  void *first = small;
+  uthread_terminate (tid);
+  allocated = false;
+  tid = uthread_spawn (allocator);
+  CHECK (runUntil ([] { return allocated; }));
+  CHECK (small == first);
+  uthread_terminate (tid);
+
+  // The chunk is taken inside the exclusive section, which must stay blocked.
+  static volatile bool stillBlocked = false;
+  taskpool_exclusive ([] {
+    uthread_alloc (2 * ARENA_CHUNK_SIZE);
+    sigset_t mask;
+    sigprocmask (SIG_BLOCK, nullptr, &mask);
+    stillBlocked = sigismember (&mask, SIGVTALRM);
+  });
+  CHECK (stillBlocked);
+  CHECK (uthread_arena_chunks (MAX_THREAD_NUM) == -1);
+
+  long before = 0;
+  for (int i = 0; i < SELF_TERMINATED; i++)
+  {
+    int target = exited + 1;
+    uthread_spawn (exiter);
+    while (exited < target)
+    {
+      uthread_yield ();
+    }
+    if (i == 1000)
+    {
+      before = rssKb ();
+    }
+  }
+  CHECK (rssKb () - before < 2048);
+  printf ("arena_test: ok\n");
+  uthread_terminate (0);
+}
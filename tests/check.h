@@ -0,0 +1,121 @@
+/*
+ * Helpers shared by the tests of the uthreads library.
+ *
+ * Every test is a program that exits with 0 when all its checks pass. Checks run on the main thread, whose stack is
+ * the OS thread's: the other threads keep the default STACK_SIZE stacks, so they only update globals for main to
+ * check.
+ */
+
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include "uthreads.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+/* Fails the test unless cond holds */
+#define CHECK(cond) \
+  do \
+  { \
+    if (!(cond)) \
+    { \
+      fprintf (stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      exit (1); \
+    } \
+  } \
+  while (0)
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+nowUsecs - reads the monotonic clock
+@return the time in microseconds
+*/
+inline long nowUsecs ()
+{
+  timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+/**
+runFor - keeps the main thread busy, so the other threads run on its preemption
+@param usecs: the wall-clock time to run
+@return void
+*/
+inline void runFor (long usecs)
+{
+  long start = nowUsecs ();
+  while (nowUsecs () - start < usecs)
+  {
+    for (volatile int i = 0; i < 10000; i++)
+    {}
+  }
+}
+
+/**
+runUntil - keeps the main thread busy until done holds. Ticks of the virtual
+ timer come every few milliseconds of CPU time, so tests wait for the effect
+ they check rather than for a fixed time.
+@param done: the condition
+@param usecs: the wall-clock time to give up after
+@return true if done holds, false if the time passed first
+*/
+template <class Condition>
+inline bool runUntil (Condition done, long usecs = 5000000)
+{
+  long start = nowUsecs ();
+  while (!done ())
+  {
+    if (nowUsecs () - start >= usecs)
+    {
+      return false;
+    }
+    runFor (1000);
+  }
+  return true;
+}
+
+/**
+threadExists - checks if a thread exists, through uthread_snapshot
+@param tid: the ID of the thread
+@return true if the thread exists, false otherwise
+*/
+inline bool threadExists (int tid)
+{
+  uthread_info info[MAX_THREAD_NUM];
+  int count = uthread_snapshot (info, MAX_THREAD_NUM);
+  for (int i = 0; i < count; i++)
+  {
+    if (info[i].tid == tid)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+rssKb - reads the resident set size of the process
+@return the size in KiB
+*/
+inline long rssKb ()
+{
+  FILE *statm = fopen ("/proc/self/statm", "r");
+  long size = 0;
+  long resident = 0;
+  if (statm != nullptr)
+  {
+    if (fscanf (statm, "%ld %ld", &size, &resident) != 2)
+    {
+      resident = 0;
+    }
+    fclose (statm);
+  }
+  return resident * 4;
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Earliest-deadline-first scheduling: admission control rejects reservations
+ * past EDF_MAX_UTILIZATION, a late deadline job is demoted so it doesn't starve
+ * the round-robin threads, a reservation is held to its runtime, and periodic
+ * jobs are released every period, also while the main thread idles.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define MEASURE_USECS 1000000
+
+static volatile long spins[MAX_THREAD_NUM];
+static volatile int jobs = 0;
+
+/**
+burn - runs one unit of work, the same on every thread so their counts compare
+@return void
+*/
+static void burn ()
+{
+  for (volatile int i = 0; i < 10000; i++)
+  {}
+}
+
+static void spinner ()
+{
+  int tid = uthread_get_tid ();
+  for (;;)
+  {
+    burn ();
+    spins[tid]++;
+  }
+}
+
+static void periodic ()
+{
+  for (;;)
+  {
+    long start = nowUsecs ();
+    while (nowUsecs () - start < 500)
+    {}
+    jobs++;
+    uthread_wait_next_period ();
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (uthread_set_deadline (0, 1000) == -1);
+  CHECK (uthread_set_reservation (0, 1000, 10000, 0) == -1);
+  CHECK (uthread_wait_next_period () == -1);
+
+  int late = uthread_spawn (spinner);
+  int reserved = uthread_spawn (spinner);
+  CHECK (uthread_set_deadline (late, -1) == -1);
+  CHECK (uthread_set_deadline (late, 2000) == 0);
+  CHECK (uthread_set_reservation (reserved, 2000, 1000, 0) == -1);
+  CHECK (uthread_set_reservation (reserved, 1000, 10000, 20000) == -1);
+  CHECK (uthread_set_reservation (reserved, 1000, 10000, 0) == 0);
+  int other = uthread_spawn (spinner);
+  CHECK (uthread_set_reservation (other, 9000, 10000, 0) == -1);
+
+  // The spinning deadline job misses its deadline at once and runs round-robin
+  // with main, while the reservation gets about a tenth of the CPU.
+  long start = nowUsecs ();
+  while (nowUsecs () - start < MEASURE_USECS)
+  {
+    burn ();
+    spins[0]++;
+  }
+  long total = spins[0] + spins[late] + spins[reserved];
+  CHECK (spins[0] > total / 4);
+  CHECK (spins[reserved] > 0 && spins[reserved] < total / 4);
+  uthread_terminate (late);
+  uthread_terminate (reserved);
+  uthread_terminate (other);
+  CHECK (uthread_get_deadline_misses (late) == -1);
+
+  int tid = uthread_spawn (periodic);
+  CHECK (uthread_set_reservation (tid, 2000, 20000, 15000) == 0);
+  start = nowUsecs ();
+  CHECK (runUntil ([] { return jobs >= 10; }));
+  // Ten releases take at least nine periods.
+  CHECK (nowUsecs () - start >= 9 * 20000);
+  CHECK (uthread_get_deadline_misses (tid) >= 0);
+  uthread_terminate (tid);
+
+  // Between jobs nothing is READY, so main sleeps in uthread_idle_wait; the
+  // wait ends by the next release rather than running to its timeout.
+  jobs = 0;
+  tid = uthread_spawn (periodic);
+  CHECK (uthread_set_reservation (tid, 2000, 20000, 0) == 0);
+  start = nowUsecs ();
+  while (jobs < 5 && nowUsecs () - start < 5000000)
+  {
+    uthread_idle_wait (1000);
+    uthread_yield ();
+  }
+  CHECK (jobs >= 5);
+  CHECK (nowUsecs () - start < 1000000);
+  uthread_terminate (tid);
+  CHECK (uthread_set_reservation (uthread_spawn (spinner), 15000, 20000, 20000) == 0);
+  printf ("deadline_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,111 @@
+/*
+ * Thread groups: a blocked group's members stop running until it is resumed,
+ * a waiter resumed early keeps waiting until the group empties, and
+ * terminating a group terminates its members and frees its ID.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define MEMBERS 3
+
+static volatile long spins[MAX_THREAD_NUM];
+static int gid;
+static volatile int waitResult = 1;
+static volatile bool waitDone = false;
+
+static void spinner ()
+{
+  int tid = uthread_get_tid ();
+  for (;;)
+  {
+    spins[tid]++;
+  }
+}
+
+static void finisher ()
+{
+  for (int i = 0; i < 3; i++)
+  {
+    uthread_yield ();
+  }
+  uthread_terminate (uthread_get_tid ());
+}
+
+static void waiter ()
+{
+  waitResult = uthread_group_wait (gid);
+  waitDone = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+/**
+memberSpins - sums the progress of the group's members
+@param tids: the members
+@return the total
+*/
+static long memberSpins (const int *tids)
+{
+  long total = 0;
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    total += spins[tids[i]];
+  }
+  return total;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  gid = uthread_group_create ();
+  CHECK (gid >= 0);
+  int tids[MEMBERS];
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    tids[i] = uthread_spawn_in_group (gid, spinner);
+    CHECK (tids[i] > 0);
+  }
+  CHECK (runUntil ([&] { return spins[tids[0]] > 0 && spins[tids[1]] > 0 && spins[tids[2]] > 0; }));
+
+  CHECK (uthread_group_block (gid) == 0);
+  runFor (10000);
+  long blocked = memberSpins (tids);
+  runFor (30000);
+  CHECK (memberSpins (tids) == blocked);
+  CHECK (uthread_group_resume (gid) == 0);
+  CHECK (runUntil ([&] { return memberSpins (tids) > blocked; }));
+  CHECK (uthread_group_get_quantums (gid) > 0);
+  CHECK (uthread_group_get_cpu_usecs (gid) > 0);
+
+  int w = uthread_spawn (waiter);
+  for (int i = 0; i < 5; i++)
+  {
+    CHECK (runUntil ([&] { return uthread_get_quantums (w) > i; }));
+    uthread_resume (w);
+  }
+  CHECK (runUntil ([&] { return uthread_get_quantums (w) > 5; }));
+  CHECK (!waitDone);
+  CHECK (uthread_group_terminate (gid) == 0);
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    CHECK (!threadExists (tids[i]));
+  }
+  CHECK (runUntil ([&] { return waitDone; }));
+  CHECK (waitResult == 0);
+  CHECK (uthread_group_block (gid) == -1);
+
+  int again = uthread_group_create ();
+  CHECK (again >= 0);
+  for (int i = 0; i < MEMBERS; i++)
+  {
+    CHECK (uthread_spawn_in_group (again, finisher) > 0);
+  }
+  CHECK (uthread_group_wait (again) == 0);
+  CHECK (uthread_group_terminate (again) == 0);
+  CHECK (uthread_spawn_in_group (again, spinner) == -1);
+  printf ("group_test: ok\n");
+  uthread_terminate (0);
+}
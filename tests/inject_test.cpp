@@ -0,0 +1,187 @@
+/*
+ * Injection queue: calls posted by several pthreads all run, in order per
+ * producer, on the dispatcher while default-stack threads keep running, calls
+ * posted by threads preempted every few microseconds all run too, and
+ * uthread_resume_async wakes a blocked thread from another OS thread. The
+ * dispatcher takes none of the user's thread IDs, and its runs aren't counted as
+ * quantums.
+ */
+
+#include <pthread.h>
+#include "uthreads.h"
+#include "check.h"
+
+#define PRODUCERS 4
+#define POSTS 20000
+#define POSTING_THREADS 3
+#define SHORT_SLICE_USECS 50
+#define POSTER_STACK_SIZE 65536
+#define ATTEMPTS 10
+
+static volatile long spins[MAX_THREAD_NUM];
+static long ran[PRODUCERS];
+static bool ordered = true;
+static volatile long posted = 0;
+static volatile bool woken = false;
+static int sleeperTid;
+
+static void spinner ()
+{
+  int tid = uthread_get_tid ();
+  for (;;)
+  {
+    spins[tid]++;
+  }
+}
+
+static void sleeper ()
+{
+  uthread_block (uthread_get_tid ());
+  woken = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+static void count (void *arg)
+{
+  long value = (long) arg;
+  int producer = (int) (value / POSTS);
+  ordered = ordered && value % POSTS == ran[producer];
+  ran[producer]++;
+}
+
+static void *produce (void *arg)
+{
+  long producer = (long) arg;
+  for (long i = 0; i < POSTS; i++)
+  {
+    while (uthread_post (count, (void *) (producer * POSTS + i)) != 0)
+    {}
+  }
+  return nullptr;
+}
+
+static void countPost (void *)
+{
+  posted++;
+}
+
+static void poster ()
+{
+  for (int i = 0; i < POSTS; i++)
+  {
+    uthread_post (countPost, nullptr);
+  }
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+/**
+postUncounted - posts calls from the main thread, the only one, and yields to
+ the dispatcher to run them
+@return true if the calls ran without a new quantum, false if a timer tick
+ landed meanwhile
+*/
+static bool postUncounted ()
+{
+  long target = posted + 3;
+  int total = uthread_get_total_quantums ();
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK (uthread_post (countPost, nullptr) == 0);
+  }
+  uthread_idle_wait (0);
+  CHECK (uthread_yield () == 0);
+  CHECK (posted == target);
+  return uthread_get_total_quantums () == total;
+}
+
+static void *resumeSleeper (void *)
+{
+  uthread_resume_async (sleeperTid);
+  return nullptr;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  bool uncounted = false;
+  for (int i = 0; i < ATTEMPTS && !uncounted; i++)
+  {
+    uncounted = postUncounted ();
+  }
+  CHECK (uncounted);
+  int tids[MAX_THREAD_NUM];
+  for (int i = 1; i < MAX_THREAD_NUM; i++)
+  {
+    tids[i] = uthread_spawn (spinner);
+    CHECK (tids[i] == i);
+  }
+  CHECK (uthread_spawn (spinner) == -1);
+  for (int i = 1; i < MAX_THREAD_NUM; i++)
+  {
+    CHECK (uthread_terminate (tids[i]) == 0);
+  }
+  posted = 0;
+  int spinnerTids[3];
+  for (int i = 0; i < 3; i++)
+  {
+    spinnerTids[i] = uthread_spawn (spinner);
+  }
+  pthread_t producers[PRODUCERS];
+  for (long i = 0; i < PRODUCERS; i++)
+  {
+    CHECK (pthread_create (&producers[i], nullptr, produce, (void *) i) == 0);
+  }
+  for (int i = 0; i < PRODUCERS; i++)
+  {
+    pthread_join (producers[i], nullptr);
+  }
+  long start = nowUsecs ();
+  bool all = false;
+  while (!all && nowUsecs () - start < 5000000)
+  {
+    runFor (1000);
+    all = true;
+    for (int i = 0; i < PRODUCERS; i++)
+    {
+      all = all && ran[i] == POSTS;
+    }
+  }
+  CHECK (all);
+  CHECK (ordered);
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK (spins[spinnerTids[i]] > 0);
+  }
+
+  // Posting from threads allocates on the scheduler's OS thread, where the timer
+  // signal lands; short slices preempt them often.
+  for (int i = 0; i < POSTING_THREADS; i++)
+  {
+    int tid = uthread_spawn_with_stack (poster, POSTER_STACK_SIZE);
+    CHECK (uthread_set_timeslice (tid, SHORT_SLICE_USECS) == 0);
+  }
+  CHECK (runUntil ([] { return posted == POSTING_THREADS * POSTS; }));
+
+  sleeperTid = uthread_spawn (sleeper);
+  runFor (20000);
+  CHECK (!woken);
+  pthread_t resumer;
+  CHECK (pthread_create (&resumer, nullptr, resumeSleeper, nullptr) == 0);
+  pthread_join (resumer, nullptr);
+  start = nowUsecs ();
+  while (!woken && nowUsecs () - start < 2000000)
+  {
+    runFor (1000);
+  }
+  CHECK (woken);
+  CHECK (uthread_resume_async (MAX_THREAD_NUM) == -1);
+  CHECK (uthread_post (nullptr, nullptr) == -1);
+  printf ("inject_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,77 @@
+/*
+ * Offload pool: a blocking call runs on a worker OS thread and returns its
+ * result and errno, other threads keep running meanwhile, also while the main
+ * thread waits on a call, and a cancelled caller stops waiting.
+ */
+
+#include <cerrno>
+#include <unistd.h>
+#include "uthreads.h"
+#include "check.h"
+
+static volatile long spins;
+static volatile long result = 0;
+static volatile int resultErrno = 0;
+static volatile bool callerDone = false;
+
+static long slowCall (void *arg)
+{
+  usleep ((long) arg);
+  errno = EAGAIN;
+  return (long) arg / 1000;
+}
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+static void caller ()
+{
+  errno = 0;
+  result = uthread_blocking_call (slowCall, (void *) 200000L);
+  resultErrno = errno;
+  callerDone = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (uthread_blocking_pool_size (0) == -1);
+  CHECK (uthread_blocking_pool_size (2) == 0);
+  uthread_spawn (spinner);
+
+  int c = uthread_spawn (caller);
+  CHECK (runUntil ([&] { return uthread_get_quantums (c) > 0; }));
+  long before = spins;
+  CHECK (runUntil ([] { return callerDone; }));
+  CHECK (result == 200 && resultErrno == EAGAIN);
+  CHECK (spins > before);
+  uthread_terminate (c);
+
+  // The main thread lets the others run while it waits.
+  before = spins;
+  errno = 0;
+  CHECK (uthread_blocking_call (slowCall, (void *) 300000L) == 300);
+  CHECK (errno == EAGAIN);
+  CHECK (spins > before);
+
+  callerDone = false;
+  c = uthread_spawn (caller);
+  CHECK (runUntil ([&] { return uthread_get_quantums (c) > 0; }));
+  CHECK (uthread_cancel (c) == 0);
+  CHECK (runUntil ([] { return callerDone; }, 150000));
+  CHECK (result == -1 && resultErrno == ECANCELED);
+  CHECK (uthread_blocking_call (nullptr, nullptr) == -1);
+  // Lets the abandoned call finish on its worker.
+  usleep (250000);
+  printf ("offload_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,52 @@
+/*
+ * Sampling profiler: timer ticks sample the running threads into collapsed
+ * stacks rooted at their thread, nothing is sampled once stopped, and samples
+ * beyond the buffer are counted as dropped.
+ */
+
+#include <sstream>
+#include <string>
+#include "uthreads.h"
+#include "profiler.h"
+#include "check.h"
+
+static volatile long spins;
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  int tid = uthread_spawn (spinner);
+  CHECK (uthread_profiler_start (100000) == 0);
+  CHECK (runUntil ([] { return uthread_profiler_dropped () == 0 && spins > 0; }));
+  runFor (300000);
+  uthread_profiler_stop ();
+
+  std::ostringstream out;
+  int samples = uthread_profiler_write_collapsed (out);
+  CHECK (samples > 10);
+  CHECK (uthread_profiler_dropped () == 0);
+  std::string stacks = out.str ();
+  CHECK (stacks.find ("uthread_" + std::to_string (tid) + ";") != std::string::npos);
+  CHECK (stacks.find ("uthread_0;") != std::string::npos);
+
+  runFor (100000);
+  std::ostringstream again;
+  CHECK (uthread_profiler_write_collapsed (again) == samples);
+
+  CHECK (uthread_profiler_start (2) == 0);
+  CHECK (runUntil ([] { return uthread_profiler_dropped () > 0; }));
+  uthread_profiler_stop ();
+  std::ostringstream full;
+  CHECK (uthread_profiler_write_collapsed (full) == 2);
+  CHECK (uthread_profiler_dropped () > 0);
+  printf ("profiler_test: ok\n");
+  uthread_terminate (0);
+}
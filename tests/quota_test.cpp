@@ -0,0 +1,88 @@
+/*
+ * CPU quotas: a thread and a group are held to their runtime per period while
+ * an unrestricted thread takes the rest, their throttled time is counted, and
+ * removing a quota releases a throttled thread.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define MEASURE_USECS 1000000
+
+static volatile long spins[MAX_THREAD_NUM];
+
+/**
+burn - runs one unit of work, the same on every thread so their counts compare
+@return void
+*/
+static void burn ()
+{
+  for (volatile int i = 0; i < 10000; i++)
+  {}
+}
+
+static void spinner ()
+{
+  int tid = uthread_get_tid ();
+  for (;;)
+  {
+    burn ();
+    spins[tid]++;
+  }
+}
+
+/**
+stateOf - takes a snapshot and finds a thread's state in it
+@param tid: the ID of the thread
+@return the UTHREAD_STATE_* value, or -1 if the thread wasn't found
+*/
+static int stateOf (int tid)
+{
+  uthread_info info[MAX_THREAD_NUM];
+  int count = uthread_snapshot (info, MAX_THREAD_NUM);
+  for (int i = 0; i < count; i++)
+  {
+    if (info[i].tid == tid)
+    {
+      return info[i].state;
+    }
+  }
+  return -1;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  int capped = uthread_spawn (spinner);
+  int gid = uthread_group_create ();
+  int members[2] = {uthread_spawn_in_group (gid, spinner), uthread_spawn_in_group (gid, spinner)};
+  int unlimited = uthread_spawn (spinner);
+  CHECK (uthread_set_quota (0, 1000, 2000) == -1);
+  CHECK (uthread_set_quota (capped, 3000, 2000) == -1);
+  CHECK (uthread_set_quota (capped, -1, 2000) == -1);
+  CHECK (uthread_group_set_quota (MAX_GROUP_NUM, 1000, 2000) == -1);
+  CHECK (uthread_set_quota (capped, 5000, 50000) == 0);
+  CHECK (uthread_group_set_quota (gid, 10000, 50000) == 0);
+
+  long start = nowUsecs ();
+  while (nowUsecs () - start < MEASURE_USECS)
+  {
+    burn ();
+    spins[0]++;
+  }
+  long group = spins[members[0]] + spins[members[1]];
+  long total = spins[0] + spins[capped] + group + spins[unlimited];
+  // The quotas allow 10% and 20% of the CPU; main and the unlimited thread share the rest.
+  CHECK (spins[capped] > 0 && spins[capped] < total / 5);
+  CHECK (group > 0 && group < total * 3 / 10);
+  CHECK (spins[unlimited] > spins[capped] && spins[unlimited] > group / 2);
+  CHECK (uthread_get_throttled_usecs (capped) > 0);
+  CHECK (uthread_group_get_throttled_usecs (gid) > 0);
+  CHECK (uthread_group_get_cpu_usecs (gid) > 0);
+
+  CHECK (runUntil ([&] { return stateOf (capped) == UTHREAD_STATE_THROTTLED; }));
+  CHECK (uthread_set_quota (capped, 0, 0) == 0);
+  CHECK (stateOf (capped) == UTHREAD_STATE_READY);
+  printf ("quota_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,82 @@
+/*
+ * Run-next slot: with the slot on, a resumed thread runs right after its waker
+ * yields, ahead of the READY spinners, also when the dispatcher is woken at the
+ * same point; with it off, it waits behind them.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define WAKES 50
+
+static volatile long spins = 0;
+static volatile long wakes = 0;
+static volatile long spinsAtWake = -1;
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+static void nothing (void *)
+{}
+
+static void sleeper ()
+{
+  for (;;)
+  {
+    spinsAtWake = spins;
+    wakes++;
+    uthread_block (uthread_get_tid ());
+  }
+}
+
+/**
+countAhead - resumes tid and yields, WAKES times
+@param tid: the ID of the blocked thread
+@param post: whether to post a call first, so the yield also wakes the dispatcher
+@return the number of wakes where tid ran before any spinner
+*/
+static int countAhead (int tid, bool post)
+{
+  int ahead = 0;
+  for (int i = 0; i < WAKES; i++)
+  {
+    long target = wakes + 1;
+    long before = spins;
+    if (post)
+    {
+      CHECK (uthread_post (nothing, nullptr) == 0);
+    }
+    CHECK (uthread_resume (tid) == 0);
+    CHECK (uthread_yield () == 0);
+    CHECK (runUntil ([&] { return wakes == target; }));
+    if (spinsAtWake == before)
+    {
+      ahead++;
+    }
+  }
+  return ahead;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  int tid = uthread_spawn (sleeper);
+  for (int i = 0; i < 3; i++)
+  {
+    uthread_spawn (spinner);
+  }
+  CHECK (runUntil ([] { return wakes == 1 && spins > 0; }));
+
+  CHECK (countAhead (tid, false) <= WAKES / 10);
+  uthread_set_run_next (1);
+  CHECK (countAhead (tid, false) >= WAKES * 9 / 10);
+  CHECK (countAhead (tid, true) >= WAKES * 9 / 10);
+  uthread_set_run_next (0);
+  printf ("run_next_test: ok\n");
+  uthread_terminate (0);
+}
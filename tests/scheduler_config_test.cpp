@@ -0,0 +1,57 @@
+/*
+ * Compile-time scheduler configuration: a custom Config sizes the tables, and
+ * the ID pool hands out the smallest free ID, never the dispatcher's, and
+ * reports when it is full.
+ */
+
+#include <type_traits>
+#include "basic_scheduler.h"
+#include "check.h"
+
+/** small_config - a configuration with a thread table of 8 and tracing compiled out */
+struct small_config
+{
+  static constexpr int max_threads = 8;
+  static constexpr int stack_size = 8192;
+  static constexpr bool stats = false;
+  static constexpr bool trace = false;
+  static constexpr int run_next_limit = 0;
+  static constexpr int shared_stack_size = 65536;
+};
+
+typedef basic_scheduler<small_config> small_scheduler;
+typedef basic_scheduler<default_scheduler_config> default_scheduler;
+
+static_assert (small_scheduler::max_threads == 8, "max_threads comes from the config");
+static_assert (std::is_same<small_scheduler::thread_table<long>, std::array<long, 9>>::value,
+               "thread tables are fixed-size arrays, with a slot for the dispatcher");
+static_assert (small_scheduler::dispatcher_tid == 8 && !small_scheduler::validTid (small_scheduler::dispatcher_tid),
+               "the dispatcher's ID is past the IDs handed out");
+static_assert (small_scheduler::validTid (7) && !small_scheduler::validTid (8)
+               && !small_scheduler::validTid (-1), "validTid is a compile-time check");
+static_assert (default_scheduler::max_threads == MAX_THREAD_NUM
+               && default_scheduler::stack_size == STACK_SIZE, "the default config follows uthreads.h");
+
+int main ()
+{
+  small_scheduler scheduler;
+  CHECK (!scheduler.full ());
+  for (int tid = 0; tid < small_scheduler::max_threads; tid++)
+  {
+    CHECK (scheduler.takeId () == tid);
+  }
+  CHECK (scheduler.full ());
+
+  scheduler.releaseId (4);
+  scheduler.releaseId (1);
+  CHECK (!scheduler.full ());
+  CHECK (scheduler.takeId () == 1);
+  CHECK (scheduler.takeId () == 4);
+  CHECK (scheduler.full ());
+  CHECK (scheduler.threads[0] == nullptr);
+
+  // Tracing is compiled out, so this records nothing even while a trace runs.
+  small_scheduler::trace (TRACE_SPAWN, 3);
+  printf ("scheduler_config_test: ok\n");
+  return 0;
+}
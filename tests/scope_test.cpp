@@ -0,0 +1,91 @@
+/*
+ * Structured concurrency scopes: a scope joins its threads when it is
+ * destroyed, cancelling it makes their blocking calls fail with ECANCELED and
+ * cancels threads spawned later, and finished scope threads are freed with
+ * the captures of their bodies destroyed while the timer is blocked.
+ */
+
+#include <cerrno>
+#include <signal.h>
+#include "uthreads.h"
+#include "arena.h"
+#include "scope.h"
+#include "check.h"
+
+#define SCOPES 3000
+
+static volatile int results[4];
+static volatile int finished = 0;
+static volatile int unmaskedDestroys = 0;
+
+/** Capture - a capture too large for std::function to keep inline, which
+ * checks the timer is blocked when a scope thread destroys it */
+struct Capture
+{
+  char payload[256];
+
+  ~Capture ()
+  {
+    if (uthread_get_tid () == 0)
+    { return; }
+    sigset_t mask;
+    sigprocmask (SIG_BLOCK, nullptr, &mask);
+    if (!sigismember (&mask, SIGVTALRM))
+    { unmaskedDestroys++; }
+  }
+};
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  {
+    Scope scope;
+    for (int i = 0; i < 4; i++)
+    {
+      CHECK (scope.spawn ([i] { uthread_sleep (i + 1); results[i] = i + 1; }) > 0);
+    }
+  }
+  CHECK (results[0] == 1 && results[3] == 4);
+
+  {
+    Scope scope;
+    scope.spawn ([] { results[0] = uthread_sleep (100000) == -1 && errno == ECANCELED; });
+    scope.spawn ([] { results[1] = uthread_block (uthread_get_tid ()) == -1 && errno == ECANCELED; });
+    scope.spawn ([] { results[2] = uthread_block_for (100000) == -1 && errno == ECANCELED; });
+    CHECK (!scope.cancelled ());
+    runFor (10000);
+    scope.cancel ();
+    CHECK (scope.cancelled ());
+    CHECK (scope.spawn ([] { results[3] = uthread_is_cancelled () && uthread_sleep (1) == -1; }) > 0);
+    CHECK (scope.join () == 0);
+    CHECK (results[0] == 1 && results[1] == 1 && results[2] == 1 && results[3] == 1);
+  }
+
+  long before = 0;
+  for (int i = 0; i < SCOPES; i++)
+  {
+    Scope scope;
+    for (int j = 0; j < 4; j++)
+    {
+      scope.spawn ([] { uthread_alloc (64); finished++; });
+    }
+    if (i == 100)
+    {
+      before = rssKb ();
+    }
+  }
+  CHECK (finished == 4 * SCOPES);
+  CHECK (rssKb () - before < 2048);
+
+  {
+    Scope scope;
+    Capture capture = {};
+    for (int i = 0; i < 4; i++)
+    {
+      scope.spawn ([capture] { results[0] = capture.payload[0]; });
+    }
+  }
+  CHECK (unmaskedDestroys == 0);
+  printf ("scope_test: ok\n");
+  uthread_terminate (0);
+}
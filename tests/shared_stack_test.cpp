@@ -0,0 +1,87 @@
+/*
+ * Shared-stack threads: threads on the shared stack keep their frames across
+ * yields and sleeps, with other shared threads and ordinary ones running in
+ * between, and terminate themselves cleanly.
+ */
+
+#include <cstring>
+#include "uthreads.h"
+#include "check.h"
+
+#define SHARED_THREADS 20
+#define FRAME_BYTES 200
+
+static volatile int corrupted = 0;
+static volatile int finished = 0;
+static volatile long spins = 0;
+
+/**
+recurse - fills a frame per level with a pattern, switches out at the bottom,
+ and checks the pattern on the way back up
+@param depth: the levels left
+@param seed: the pattern of the calling thread
+@return the number of levels, depth + 1
+*/
+static int recurse (int depth, int seed)
+{
+  char frame[FRAME_BYTES];
+  memset (frame, seed + depth, sizeof frame);
+  int levels = 1;
+  if (depth > 0)
+  {
+    levels += recurse (depth - 1, seed);
+  }
+  else
+  {
+    uthread_yield ();
+    uthread_sleep (1);
+    uthread_yield ();
+  }
+  for (int i = 0; i < FRAME_BYTES; i++)
+  {
+    if (frame[i] != (char) (seed + depth))
+    {
+      corrupted++;
+      break;
+    }
+  }
+  return levels;
+}
+
+static void worker ()
+{
+  int tid = uthread_get_tid ();
+  for (int round = 0; round < 3; round++)
+  {
+    int depth = 3 + (tid * 7 + round) % 20;
+    if (recurse (depth, tid) != depth + 1)
+    {
+      corrupted++;
+    }
+  }
+  finished++;
+  uthread_terminate (tid);
+}
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  uthread_spawn (spinner);
+  for (int i = 0; i < SHARED_THREADS; i++)
+  {
+    CHECK (uthread_spawn_shared (worker) > 0);
+  }
+  CHECK (runUntil ([] { return finished == SHARED_THREADS; }, 20000000));
+  CHECK (corrupted == 0);
+  CHECK (spins > 0);
+  printf ("shared_stack_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,99 @@
+/*
+ * Snapshots and the watchdog: uthread_snapshot reports each thread's state in
+ * thread ID order, and the watchdog reports a thread that keeps the CPU
+ * without blocking.
+ */
+
+#include "uthreads.h"
+#include "watchdog.h"
+#include "check.h"
+
+static volatile long spins = 0;
+static volatile bool monopolized[MAX_THREAD_NUM];
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+static void blocker ()
+{
+  uthread_block (uthread_get_tid ());
+}
+
+static void sleeper ()
+{
+  for (;;)
+  {
+    uthread_sleep (1000);
+  }
+}
+
+static void onWatchdog (int tid, int reason, long usecs)
+{
+  if (reason == UTHREAD_WATCHDOG_MONOPOLY && usecs > 0)
+  {
+    monopolized[tid] = true;
+  }
+}
+
+/**
+infoOf - takes a snapshot and finds a thread in it
+@param tid: the ID of the thread
+@param info: set to the thread's state
+@return true if the thread was found, false otherwise
+*/
+static bool infoOf (int tid, uthread_info *info)
+{
+  uthread_info all[MAX_THREAD_NUM];
+  int count = uthread_snapshot (all, MAX_THREAD_NUM);
+  for (int i = 0; i < count; i++)
+  {
+    if (i > 0)
+    {
+      CHECK (all[i - 1].tid < all[i].tid);
+    }
+    if (all[i].tid == tid)
+    {
+      *info = all[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  uthread_info info[1];
+  CHECK (uthread_snapshot (info, -1) == -1);
+  CHECK (uthread_snapshot (info, 0) == 0);
+  CHECK (uthread_snapshot (info, 1) == 1);
+  CHECK (info[0].tid == 0 && info[0].state == UTHREAD_STATE_RUNNING && info[0].idle_usecs == 0);
+
+  int spinning = uthread_spawn (spinner);
+  int blocked = uthread_spawn (blocker);
+  int sleeping = uthread_spawn (sleeper);
+  CHECK (runUntil ([&] { return spins > 0 && uthread_get_quantums (blocked) > 0
+                                && uthread_get_quantums (sleeping) > 0; }));
+  uthread_info state;
+  CHECK (infoOf (spinning, &state) && state.state == UTHREAD_STATE_READY);
+  CHECK (state.quantums > 0 && state.busy_usecs > 0);
+  CHECK (infoOf (blocked, &state) && state.state == UTHREAD_STATE_BLOCKED);
+  CHECK (infoOf (sleeping, &state) && state.state == UTHREAD_STATE_SLEEPING && state.sleep_quantums > 0);
+  uthread_terminate (blocked);
+  CHECK (!infoOf (blocked, &state));
+
+  CHECK (uthread_watchdog_start (0, 0, onWatchdog) == -1);
+  CHECK (uthread_watchdog_start (-1, 20000, onWatchdog) == -1);
+  CHECK (uthread_watchdog_start (0, 20000, nullptr) == -1);
+  CHECK (uthread_watchdog_start (0, 20000, onWatchdog) == 0);
+  CHECK (runUntil ([&] { return monopolized[spinning]; }));
+  CHECK (!monopolized[sleeping]);
+  uthread_watchdog_stop ();
+  printf ("snapshot_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,83 @@
+/*
+ * Task pool: parallel_for covers every index once, parallel_reduce combines the
+ * partial results, and task_sync waits for tasks spawned from the main thread.
+ * Splitting ranges allocates only with the timer signal blocked.
+ */
+
+#include <new>
+#include <signal.h>
+#include "uthreads.h"
+#include "taskpool.h"
+#include "check.h"
+
+#define N 100000
+
+static char hits[N];
+
+/** countUnmasked - set while the allocations made with the timer enabled are counted */
+static volatile bool countUnmasked = false;
+static volatile int unmaskedAllocs = 0;
+
+void *operator new (std::size_t size)
+{
+  if (countUnmasked)
+  {
+    sigset_t mask;
+    sigprocmask (SIG_BLOCK, nullptr, &mask);
+    if (!sigismember (&mask, SIGVTALRM))
+    { unmaskedAllocs++; }
+  }
+  void *p = malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+  { throw std::bad_alloc (); }
+  return p;
+}
+
+void operator delete (void *p) noexcept
+{
+  free (p);
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (taskpool_init (4) == 0);
+
+  countUnmasked = true;
+  parallel_for (0, N, 0, [] (long i) { hits[i]++; });
+  for (int i = 0; i < N; i++)
+  {
+    CHECK (hits[i] == 1);
+  }
+
+  long sum = parallel_reduce<long> (0, N, 64, 0L,
+                                    [] (long b, long e, long acc)
+                                    {
+                                      for (long i = b; i < e; i++)
+                                      { acc += i; }
+                                      return acc;
+                                    },
+                                    [] (long a, long b) { return a + b; });
+  countUnmasked = false;
+  CHECK (unmaskedAllocs == 0);
+  CHECK (sum == (long) N * (N - 1) / 2);
+  CHECK (parallel_reduce<long> (5, 5, 1, 7L, [] (long, long, long acc) { return acc; },
+                                [] (long a, long b) { return a + b; }) == 7);
+
+  TaskGroup group;
+  int done[64] = {0};
+  for (int i = 0; i < 64; i++)
+  {
+    task_spawn (group, [&done, i] { done[i] = i + 1; });
+  }
+  task_sync (group);
+  CHECK (group.isDone ());
+  for (int i = 0; i < 64; i++)
+  {
+    CHECK (done[i] == i + 1);
+  }
+
+  CHECK (taskpool_shutdown () == 0);
+  printf ("taskpool_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,76 @@
+/*
+ * Scheduler timers: a periodic timer fires every interval, both while threads
+ * run and in an idle loop, a one-shot timer fires once and stops existing, and
+ * a cancelled timer doesn't fire.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define PERIOD_USECS 10000
+#define IDLE_USECS 300000
+
+static volatile int ticks = 0;
+static volatile int shots = 0;
+static volatile int cancelledShots = 0;
+static volatile long spins = 0;
+
+static void tick (void *)
+{
+  ticks++;
+}
+
+static void shoot (void *counter)
+{
+  (*(volatile int *) counter)++;
+}
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (uthread_timer_create (0, tick, nullptr, UTHREAD_TIMER_PERIODIC) == -1);
+  CHECK (uthread_timer_create (PERIOD_USECS, nullptr, nullptr, UTHREAD_TIMER_PERIODIC) == -1);
+  CHECK (uthread_timer_create (PERIOD_USECS, tick, nullptr, 5) == -1);
+  CHECK (uthread_timer_cancel (7) == -1);
+
+  int tid = uthread_spawn (spinner);
+  int periodic = uthread_timer_create (PERIOD_USECS, tick, nullptr, UTHREAD_TIMER_PERIODIC);
+  int oneShot = uthread_timer_create (2 * PERIOD_USECS, shoot, (void *) &shots, UTHREAD_TIMER_ONESHOT);
+  int cancelled = uthread_timer_create (3 * PERIOD_USECS, shoot, (void *) &cancelledShots, UTHREAD_TIMER_ONESHOT);
+  CHECK (periodic >= 0 && oneShot >= 0 && cancelled >= 0);
+  CHECK (uthread_timer_cancel (cancelled) == 0);
+  CHECK (runUntil ([] { return ticks >= 5 && shots == 1; }));
+  CHECK (uthread_timer_cancel (oneShot) == -1);
+  CHECK (spins > 0);
+  uthread_terminate (tid);
+
+  // With nothing else to run, the idle loop wakes up for each period.
+  int before = ticks;
+  long start = nowUsecs ();
+  while (nowUsecs () - start < IDLE_USECS)
+  {
+    uthread_idle_wait (-1);
+  }
+  int fired = ticks - before;
+  CHECK (fired >= IDLE_USECS / PERIOD_USECS / 2 && fired <= IDLE_USECS / PERIOD_USECS + 2);
+
+  CHECK (uthread_timer_cancel (periodic) == 0);
+  before = ticks;
+  start = nowUsecs ();
+  while (nowUsecs () - start < 10 * PERIOD_USECS)
+  {
+    uthread_idle_wait (20);
+  }
+  CHECK (ticks - before <= 1);
+  CHECK (shots == 1 && cancelledShots == 0);
+  printf ("timer_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,42 @@
+/*
+ * Per-thread time slices: a thread with a longer slice gets more CPU than an
+ * identical thread on the default quantum, while both are still counted one
+ * quantum per scheduling.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+static volatile long spins[MAX_THREAD_NUM];
+
+static void spinner ()
+{
+  int tid = uthread_get_tid ();
+  for (;;)
+  {
+    spins[tid]++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  int longSlice = uthread_spawn (spinner);
+  int shortSlice = uthread_spawn (spinner);
+  CHECK (uthread_get_timeslice (longSlice) == 1000);
+  CHECK (uthread_set_timeslice (longSlice, 20000) == 0);
+  CHECK (uthread_get_timeslice (longSlice) == 20000);
+  CHECK (uthread_set_timeslice (shortSlice, -1) == -1);
+  CHECK (uthread_set_carry_over (shortSlice, 1) == 0);
+
+  CHECK (runUntil ([&] { return uthread_get_quantums (longSlice) >= 10
+                                && uthread_get_quantums (shortSlice) >= 10; }));
+  int quantumGap = uthread_get_quantums (longSlice) - uthread_get_quantums (shortSlice);
+  CHECK (quantumGap >= -2 && quantumGap <= 2);
+  CHECK (spins[longSlice] > 2 * spins[shortSlice]);
+
+  CHECK (uthread_set_timeslice (longSlice, 0) == 0);
+  CHECK (uthread_get_timeslice (longSlice) == 1000);
+  printf ("timeslice_test: ok\n");
+  uthread_terminate (0);
+}
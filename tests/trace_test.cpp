@@ -0,0 +1,135 @@
+/*
+ * Event trace: spawns, switches, blocks, resumes and terminations are recorded
+ * in order and written in the trace file format, switch-outs tell preemption,
+ * yields and group blocks apart, and blocking a thread that isn't running
+ * records no switch-out.
+ */
+
+#include <cstring>
+#include <unistd.h>
+#include "uthreads.h"
+#include "trace.h"
+#include "check.h"
+
+#define CAPACITY 4096
+
+static volatile long spins;
+static volatile int gid;
+static volatile bool groupBlocking = false;
+static volatile bool groupResumed = false;
+
+static void blocker ()
+{
+  uthread_block (uthread_get_tid ());
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+static void groupBlocker ()
+{
+  groupBlocking = true;
+  uthread_group_block (gid);
+  groupResumed = true;
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+static TraceEvent events[CAPACITY];
+
+/**
+countEvents - counts the recorded events that match
+@param count: the number of events
+@param type: the event type
+@param tid: the thread
+@param reason: the reason, for TRACE_SWITCH_OUT
+@return the number of matching events
+*/
+static int countEvents (int count, int type, int tid, int reason = TRACE_NO_REASON)
+{
+  int matches = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (events[i].type == type && events[i].tid == tid
+        && (type != TRACE_SWITCH_OUT || events[i].reason == reason))
+    {
+      matches++;
+    }
+  }
+  return matches;
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (uthread_trace_start (CAPACITY) == 0);
+  int a = uthread_spawn (blocker);
+  int b = uthread_spawn (spinner);
+  CHECK (runUntil ([&] { return spins > 0 && uthread_get_quantums (a) > 0; }));
+  uthread_block (b);
+  uthread_resume (a);
+  CHECK (runUntil ([&] { return uthread_get_quantums (a) > 1; }));
+  // Spawned before b terminates, so it doesn't get b's ID.
+  gid = uthread_group_create ();
+  int g = uthread_spawn_in_group (gid, groupBlocker);
+  uthread_terminate (b);
+  CHECK (runUntil ([] { return groupBlocking; }));
+  runFor (10000);
+  CHECK (uthread_group_resume (gid) == 0);
+  CHECK (runUntil ([] { return groupResumed; }));
+  CHECK (uthread_group_terminate (gid) == 0);
+  uthread_trace_stop ();
+  runFor (10000);
+
+  char path[] = "/tmp/uthreads_traceXXXXXX";
+  int fd = mkstemp (path);
+  CHECK (fd >= 0);
+  close (fd);
+  int written = uthread_trace_write (path);
+  CHECK (written > 0 && written < CAPACITY);
+  FILE *file = fopen (path, "rb");
+  CHECK (file != nullptr);
+  TraceFileHeader header;
+  CHECK (fread (&header, sizeof (header), 1, file) == 1);
+  CHECK (memcmp (header.magic, TRACE_MAGIC, sizeof (header.magic)) == 0);
+  CHECK ((int) header.count == written);
+  CHECK (header.overwritten == 0);
+  CHECK (fread (events, sizeof (TraceEvent), written, file) == (size_t) written);
+  fclose (file);
+  unlink (path);
+
+  for (int i = 1; i < written; i++)
+  {
+    CHECK (events[i].timestamp_ns >= events[i - 1].timestamp_ns);
+  }
+  CHECK (countEvents (written, TRACE_SPAWN, a) == 1);
+  CHECK (countEvents (written, TRACE_SPAWN, b) == 1);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, a, TRACE_BLOCK) == 1);
+  CHECK (countEvents (written, TRACE_RESUME, a) == 1);
+  CHECK (countEvents (written, TRACE_SWITCH_IN, a) >= 2);
+  CHECK (countEvents (written, TRACE_SWITCH_IN, b) >= 1);
+  // b was READY when main blocked it.
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, b, TRACE_BLOCK) == 0);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, b, TRACE_TERMINATE) == 1);
+  // b only ever spun, while a yields in a loop once resumed.
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, b, TRACE_PREEMPT) >= 1);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, b, TRACE_YIELD) == 0);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, a, TRACE_YIELD) >= 1);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, g, TRACE_GROUP_BLOCK) == 1);
+  CHECK (countEvents (written, TRACE_SWITCH_OUT, 0, TRACE_GROUP_BLOCK) == 0);
+
+  CHECK (uthread_trace_start (0) == -1);
+  printf ("trace_test: ok\n");
+  uthread_terminate (0);
+}
@@ -0,0 +1,98 @@
+/*
+ * Timed waits and wait-any: uthread_block_for times out or is resumed, and
+ * uthread_wait_any returns the source that fired: a readable pipe, a thread
+ * exit, or a source already satisfied.
+ */
+
+#include <poll.h>
+#include <unistd.h>
+#include "uthreads.h"
+#include "check.h"
+
+static volatile int results[5] = {-2, -2, -2, -2, -2};
+static int pipeFds[2];
+static int exitingTid;
+
+static void park ()
+{
+  for (;;)
+  {
+    uthread_yield ();
+  }
+}
+
+static void timesOut ()
+{
+  results[0] = uthread_block_for (3);
+  park ();
+}
+
+static void resumed ()
+{
+  results[1] = uthread_block_for (100000);
+  park ();
+}
+
+static void waitsForFd ()
+{
+  wake_source sources[] = {{UTHREAD_WAKE_TIMER, 100000, 0},
+                           {UTHREAD_WAKE_FD, pipeFds[0], POLLIN}};
+  results[2] = uthread_wait_any (sources, 2);
+  park ();
+}
+
+static void waitsForExit ()
+{
+  wake_source sources[] = {{UTHREAD_WAKE_RESUME, 0, 0},
+                           {UTHREAD_WAKE_EXIT, exitingTid, 0}};
+  results[3] = uthread_wait_any (sources, 2);
+  // The thread is gone now, so the wait returns at once.
+  results[4] = uthread_wait_any (sources + 1, 1);
+  park ();
+}
+
+static void spinner ()
+{
+  for (;;)
+  {}
+}
+
+int main ()
+{
+  CHECK (uthread_init (1000) == 0);
+  CHECK (pipe (pipeFds) == 0);
+  exitingTid = uthread_spawn (spinner);
+  int tids[4] = {uthread_spawn (timesOut), uthread_spawn (resumed),
+                 uthread_spawn (waitsForFd), uthread_spawn (waitsForExit)};
+  CHECK (runUntil ([&] { return uthread_get_quantums (tids[1]) > 0
+                                && uthread_get_quantums (tids[2]) > 0
+                                && uthread_get_quantums (tids[3]) > 0; }));
+
+  CHECK (runUntil ([] { return results[0] != -2; }));
+  CHECK (results[0] == 0);
+
+  runFor (10000);
+  CHECK (results[1] == -2);
+  uthread_resume (tids[1]);
+  CHECK (runUntil ([] { return results[1] != -2; }));
+  CHECK (results[1] == 1);
+
+  runFor (10000);
+  CHECK (results[2] == -2);
+  CHECK (write (pipeFds[1], "x", 1) == 1);
+  CHECK (runUntil ([] { return results[2] != -2; }));
+  CHECK (results[2] == 1);
+
+  CHECK (results[3] == -2);
+  uthread_terminate (exitingTid);
+  CHECK (runUntil ([] { return results[3] != -2; }));
+  CHECK (results[3] == 1);
+  CHECK (runUntil ([] { return results[4] != -2; }));
+  CHECK (results[4] == 0);
+
+  CHECK (uthread_block_for (1) == -1);
+  wake_source none[] = {{UTHREAD_WAKE_EXIT, exitingTid, 0}};
+  CHECK (uthread_wait_any (none, 1) == -1);
+  printf ("wait_test: ok\n");
+  uthread_terminate (0);
+}
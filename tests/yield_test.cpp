@@ -0,0 +1,63 @@
+/*
+ * Yields: uthread_yield keeps the quantum when nothing else is READY, and
+ * uthread_yield_to hands the CPU straight to its target and back, ahead of the
+ * other READY threads.
+ */
+
+#include "uthreads.h"
+#include "check.h"
+
+#define HANDOFFS 100
+
+static volatile long handoffs = 0;
+static volatile long spins = 0;
+
+static void target ()
+{
+  for (;;)
+  {
+    handoffs++;
+    uthread_yield_to (0);
+  }
+}
+
+static void spinner ()
+{
+  for (;;)
+  {
+    spins++;
+  }
+}
+
+int main ()
+{
+  CHECK (uthread_init (10000) == 0);
+  int total = uthread_get_total_quantums ();
+  CHECK (uthread_yield () == 0);
+  CHECK (uthread_get_total_quantums () == total);
+  CHECK (uthread_yield_to (MAX_THREAD_NUM - 2) == -1);
+
+  int tid = uthread_spawn (target);
+  for (int i = 0; i < 3; i++)
+  {
+    uthread_spawn (spinner);
+  }
+  CHECK (runUntil ([] { return spins > 0 && handoffs > 0; }));
+
+  // Each handoff runs the target and comes straight back, so none of the
+  // spinners' quantums fall in between, short of a preemption.
+  int direct = 0;
+  for (int i = 0; i < HANDOFFS; i++)
+  {
+    long before = handoffs;
+    long spun = spins;
+    CHECK (uthread_yield_to (tid) == 0);
+    if (handoffs == before + 1 && spins == spun)
+    {
+      direct++;
+    }
+  }
+  CHECK (direct >= HANDOFFS * 9 / 10);
+  printf ("yield_test: ok\n");
+  uthread_terminate (0);
+}
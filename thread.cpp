@@ -1,6 +1,12 @@
 #include "thread.h"
+#include "uthreads_internal.h"
 #include <signal.h>
 #include <memory>
+#include <cstring>
+#include <sys/mman.h>
+
+#define SAVE_PAGE_SIZE 4096
+#define SAVE_BAD_ALLOC_ERR "bad alloc"
 
 #ifdef __x86_64__
 /* code for 64 bit Intel arch */
@@ -46,22 +52,47 @@ address_t translate_address(address_t addr)
 
 /** ~~~~~~~~~~~~~~~~~~ Thread Class ~~~~~~~~~~~ **/
 
-Thread::Thread (int id, thread_entry_point entry_point)
+Thread::Thread (int id, thread_entry_point entry_point, int stack_size,
+                thread_entry_point start_routine, char* shared_stack)
 {
   this->id = id;
   this->state = READY;
-  this->stack = new char[STACK_SIZE];
-  sigsetjmp(env, 1);
+  this->stack_size = stack_size;
+  this->entry_point = entry_point;
+  this->group = NO_GROUP;
+  this->timeslice = 0;
+  this->carry_over = false;
+  this->carried = 0;
+  this->shared = shared_stack != nullptr;
+  this->shared_sp = nullptr;
+  this->saved = nullptr;
+  this->saved_size = 0;
+  this->saved_capacity = 0;
+  this->link.prev = nullptr;
+  this->link.next = nullptr;
+  this->link.thread = this;
+  this->stack = shared ? shared_stack : new char[stack_size];
   if (id != 0)
   {
     this->quantums = 0;
-    address_t sp = (address_t) stack + STACK_SIZE - sizeof (address_t);
-    address_t pc = (address_t) entry_point;
-    (env->__jmpbuf)[JB_SP] = translate_address (sp);
-    (env->__jmpbuf)[JB_PC] = translate_address (pc);
+    initContext (env, stack, stack_size,
+                 start_routine != nullptr ? start_routine : entry_point);
   }
   else
-  { this->quantums = 1; }
+  {
+    this->quantums = 1;
+    sigsetjmp(env, 1);
+    sigemptyset (&env->__saved_mask);
+  }
+}
+
+void initContext (sigjmp_buf env, char* stack, int stack_size, thread_entry_point entry)
+{
+  sigsetjmp(env, 1);
+  address_t sp = (address_t) stack + stack_size - sizeof (address_t);
+  address_t pc = (address_t) entry;
+  (env->__jmpbuf)[JB_SP] = translate_address (sp);
+  (env->__jmpbuf)[JB_PC] = translate_address (pc);
   sigemptyset (&env->__saved_mask);
 }
 
@@ -72,6 +103,56 @@ bool Thread::isEqual (std::shared_ptr<Thread> other)
   return other->id == this->id;
 }
 
+void Thread::setSharedSp (char* sp)
+{
+  this->shared_sp = sp;
+}
+
+void Thread::saveStack ()
+{
+  if (shared_sp == nullptr)
+  { return; }
+  int size = (int) (stack + stack_size - shared_sp);
+  // Mapped in powers of two pages, so the mapping only changes when the depth
+  // the thread switches out at grows past it or drops well below it.
+  if (size > saved_capacity
+      || (saved_capacity > SAVE_PAGE_SIZE && 4 * size < saved_capacity))
+  {
+    unmapSaved ();
+    saved_capacity = SAVE_PAGE_SIZE;
+    while (saved_capacity < size)
+    {
+      saved_capacity *= 2;
+    }
+    void *map = mmap (nullptr, saved_capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+    {
+      err_sys_print (SAVE_BAD_ALLOC_ERR);
+    }
+    saved = (char *) map;
+  }
+  memcpy (saved, shared_sp, size);
+  saved_size = size;
+  shared_sp = nullptr;
+}
+
+void Thread::restoreStack ()
+{
+  memcpy (stack + stack_size - saved_size, saved, saved_size);
+  saved_size = 0;
+}
+
+void Thread::unmapSaved ()
+{
+  if (saved != nullptr)
+  {
+    munmap (saved, saved_capacity);
+  }
+  saved = nullptr;
+  saved_capacity = 0;
+}
+
 
 void Thread::incrementQuantum ()
 { this->quantums++; }
@@ -83,6 +164,71 @@ int Thread::getId ()
   return this->id;
 }
 
+thread_entry_point Thread::getEntryPoint ()
+{
+  return this->entry_point;
+}
+
+char* Thread::getStack ()
+{
+  return this->stack;
+}
+
+bool Thread::isShared ()
+{
+  return this->shared;
+}
+
+int Thread::getSavedSize ()
+{
+  return this->saved_size;
+}
+
+int Thread::getStackSize ()
+{
+  return this->stack_size;
+}
+
+int Thread::getGroup ()
+{
+  return this->group;
+}
+
+void Thread::setGroup (int gid)
+{
+  this->group = gid;
+}
+
+int Thread::getTimeslice ()
+{
+  return this->timeslice;
+}
+
+void Thread::setTimeslice (int usecs)
+{
+  this->timeslice = usecs;
+}
+
+bool Thread::getCarryOver ()
+{
+  return this->carry_over;
+}
+
+void Thread::setCarryOver (bool carry_over)
+{
+  this->carry_over = carry_over;
+}
+
+int Thread::getCarried ()
+{
+  return this->carried;
+}
+
+void Thread::setCarried (int usecs)
+{
+  this->carried = usecs;
+}
+
 void Thread::setState (ThreadState st)
 {
   this->state = st;
@@ -98,7 +244,11 @@ int Thread::getQuantums ()
 
 Thread::~Thread()
 {
+  if (!shared)
+  {
     delete[] stack;
+  }
+  unmapSaved ();
 }
 
 
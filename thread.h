@@ -1,17 +1,34 @@
+#ifndef _THREAD_H
+#define _THREAD_H
+
 /** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
 
 #include <iostream>
 #include <setjmp.h>
 #include <memory>
+#include <vector>
+#include "uthreads.h"
+#include "arena.h"
 
 /** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
 
-#define STACK_SIZE 4096 /* stack size per thread (in bytes) */
-
-typedef void (*thread_entry_point)(void);
+#define NO_GROUP -1 /* group of threads that don't belong to a group */
 
 enum ThreadState{ READY, RUNNING, BLOCKED };
 
+class Thread;
+
+/**
+ * A QueueLink places a thread in a ThreadQueue. Links are intrusive, so a thread can be unlinked in O(1) without
+ * knowing which queue holds it.
+ */
+struct QueueLink
+{
+  QueueLink* prev;        // The previous link, nullptr while not queued
+  QueueLink* next;        // The next link, nullptr while not queued
+  Thread* thread;         // The thread of this link, nullptr for a queue's sentinel
+};
+
 /**
  * The Thread class represents a single thread of execution in a multi-threaded program.
  */
@@ -22,6 +39,22 @@ class Thread
   int quantums;           // The number of quantum ticks this thread has received
   ThreadState state;      // The current state of the thread
   char* stack;// The stack used by the thread
+  int stack_size;         // The size of the stack in bytes
+  thread_entry_point entry_point; // The function the thread runs
+  int group;              // The ID of the thread's group, or NO_GROUP
+  int timeslice;          // The length of the thread's quantums in microseconds, or 0 for the library's quantum
+  bool carry_over;        // Whether unused time of a quantum ended early is added to the next one
+  int carried;            // Unused time, in microseconds, added to the thread's next quantum
+  bool shared;            // Whether the thread runs on a shared stack instead of a stack of its own
+  char* shared_sp;        // The lowest address of the thread's frames on the shared stack when it last switched out
+  char* saved;            // The thread's frames, copied out while another thread runs on the shared stack
+  int saved_size;         // The size of the saved frames in bytes, 0 while they are on the shared stack
+  int saved_capacity;     // The size of the mapping holding the saved frames, a power of two pages, or 0
+
+  /**
+   * Unmaps the buffer of this thread object's saved frames, if any.
+   */
+  void unmapSaved();
 
  public:
   /**
@@ -29,13 +62,20 @@ class Thread
    *
    * @param id The ID of the new thread.
    * @param entry_point The entry point of the new thread.
+   * @param stack_size The size of the new thread's stack in bytes.
+   * @param start_routine The code the thread starts executing, which must call entry_point,
+   * or nullptr to start directly at entry_point.
+   * @param shared_stack A stack of stack_size bytes shared with other threads, or nullptr to allocate one.
    */
-  Thread(int id, thread_entry_point entry_point);
+  Thread(int id, thread_entry_point entry_point, int stack_size = STACK_SIZE,
+         thread_entry_point start_routine = nullptr, char* shared_stack = nullptr);
 
   sigjmp_buf env;         // The environment buffer used for saving and restoring the thread state
+  QueueLink link;         // The thread's place in the ready queue or in its group's parked queue
+  Arena arena;            // The memory of uthread_alloc, released with the thread
   /**
   * @brief Destructor for the Thread class.
-  * This destructor deallocates the memory used by the thread's stack.
+  * This destructor deallocates the memory used by the thread's stack, unless it is shared.
   * @param None
   * @return None
   */
@@ -55,6 +95,116 @@ class Thread
    */
   int getId();
 
+  /**
+   * Returns the entry point of this thread object.
+   *
+   * @return The entry point of the thread.
+   */
+  thread_entry_point getEntryPoint();
+
+  /**
+   * Returns the lowest address of this thread object's stack.
+   *
+   * @return The base of the stack.
+   */
+  char* getStack();
+
+  /**
+   * Returns the size of this thread object's stack.
+   *
+   * @return The size of the stack in bytes.
+   */
+  int getStackSize();
+
+  /**
+   * Returns whether this thread object runs on a shared stack.
+   *
+   * @return True if the stack is shared.
+   */
+  bool isShared();
+
+  /**
+   * Records where this thread object's frames on the shared stack end, as it switches out.
+   *
+   * @param sp An address below the frames of the thread, above any frame it doesn't return to.
+   */
+  void setSharedSp(char* sp);
+
+  /**
+   * Copies this thread object's frames out of the shared stack, from the address given to setSharedSp up to the top,
+   * into a buffer sized to them. The buffer is mapped rather than allocated, so scheduling points may call this.
+   */
+  void saveStack();
+
+  /**
+   * Copies this thread object's frames saved by saveStack back to the top of the shared stack.
+   * The caller must run below them.
+   */
+  void restoreStack();
+
+  /**
+   * Returns the size of this thread object's saved frames.
+   *
+   * @return The size in bytes, 0 while its frames are on the shared stack.
+   */
+  int getSavedSize();
+
+  /**
+   * Returns the ID of this thread object's group.
+   *
+   * @return The group ID, or NO_GROUP.
+   */
+  int getGroup();
+
+  /**
+   * Sets the group of this thread object.
+   *
+   * @param gid The group ID, or NO_GROUP.
+   */
+  void setGroup(int gid);
+
+  /**
+   * Returns the length of this thread object's quantums.
+   *
+   * @return The time slice in microseconds, or 0 for the library's quantum.
+   */
+  int getTimeslice();
+
+  /**
+   * Sets the length of this thread object's quantums.
+   *
+   * @param usecs The time slice in microseconds, or 0 for the library's quantum.
+   */
+  void setTimeslice(int usecs);
+
+  /**
+   * Returns whether this thread object carries unused time over to its next quantum.
+   *
+   * @return True if unused time is carried over.
+   */
+  bool getCarryOver();
+
+  /**
+   * Sets whether this thread object carries unused time over to its next quantum.
+   *
+   * @param carry_over True to carry unused time over.
+   */
+  void setCarryOver(bool carry_over);
+
+  /**
+   * Returns the unused time this thread object carries over to its next quantum.
+   *
+   * @return The carried time in microseconds.
+   */
+  int getCarried();
+
+  /**
+   * Sets the unused time this thread object carries over to its next quantum.
+   *
+   * @param usecs The carried time in microseconds.
+   */
+  void setCarried(int usecs);
+
   /**
    * Sets the state of this thread object.
    *
@@ -81,3 +231,16 @@ class Thread
    */
   void incrementQuantum();
 };
+
+/**
+ * Prepares a context that starts executing entry at the top of a stack when it is jumped into. The context is
+ * entered with an empty signal mask.
+ *
+ * @param env The context to prepare.
+ * @param stack The lowest address of the stack.
+ * @param stack_size The size of the stack in bytes.
+ * @param entry The function the context starts in, which must not return.
+ */
+void initContext(sigjmp_buf env, char* stack, int stack_size, thread_entry_point entry);
+
+#endif
@@ -0,0 +1,79 @@
+#include "thread_queue.h"
+
+/** ~~~~~~~~~~~~~~~~~~ ThreadQueue Class ~~~~~~~~~~~ **/
+
+ThreadQueue::ThreadQueue ()
+{
+  sentinel.prev = &sentinel;
+  sentinel.next = &sentinel;
+  sentinel.thread = nullptr;
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Methods ~~~~~~~~~~~ **/
+
+bool ThreadQueue::empty ()
+{
+  return sentinel.next == &sentinel;
+}
+
+Thread* ThreadQueue::front ()
+{
+  return sentinel.next->thread;
+}
+
+void ThreadQueue::pushBack (Thread* thread)
+{
+  QueueLink* link = &thread->link;
+  link->prev = sentinel.prev;
+  link->next = &sentinel;
+  sentinel.prev->next = link;
+  sentinel.prev = link;
+}
+
+Thread* ThreadQueue::popFront ()
+{
+  Thread* thread = front ();
+  if (thread != nullptr)
+  {
+    unlink (thread);
+  }
+  return thread;
+}
+
+void ThreadQueue::spliceBack (ThreadQueue& other)
+{
+  if (other.empty ())
+  { return; }
+  QueueLink* first = other.sentinel.next;
+  QueueLink* last = other.sentinel.prev;
+  first->prev = sentinel.prev;
+  sentinel.prev->next = first;
+  last->next = &sentinel;
+  sentinel.prev = last;
+  other.sentinel.next = &other.sentinel;
+  other.sentinel.prev = &other.sentinel;
+}
+
+void ThreadQueue::clear ()
+{
+  while (!empty ())
+  {
+    popFront ();
+  }
+}
+
+void ThreadQueue::unlink (Thread* thread)
+{
+  QueueLink* link = &thread->link;
+  if (link->next == nullptr)
+  { return; }
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->prev = nullptr;
+  link->next = nullptr;
+}
+
+bool ThreadQueue::isQueued (Thread* thread)
+{
+  return thread->link.next != nullptr;
+}
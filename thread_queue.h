@@ -0,0 +1,83 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+
+#ifndef _THREAD_QUEUE_H
+#define _THREAD_QUEUE_H
+
+#include "thread.h"
+
+/**
+ * The ThreadQueue class is a FIFO of threads, linked through the threads' own QueueLink.
+ * A thread is in at most one queue at a time. Pushing, popping, unlinking any thread and moving a whole queue to the
+ * end of another are all O(1) and never allocate.
+ */
+class ThreadQueue
+{
+ private:
+  QueueLink sentinel;     // The link before the first and after the last thread
+
+ public:
+  /**
+   * Constructs an empty queue.
+   */
+  ThreadQueue();
+
+  ThreadQueue(const ThreadQueue&) = delete;
+  ThreadQueue& operator=(const ThreadQueue&) = delete;
+
+  /**
+   * Determines whether the queue holds no threads.
+   *
+   * @return True if the queue is empty, false otherwise.
+   */
+  bool empty();
+
+  /**
+   * Returns the first thread of the queue.
+   *
+   * @return The first thread, or nullptr if the queue is empty.
+   */
+  Thread* front();
+
+  /**
+   * Appends a thread that isn't in any queue.
+   *
+   * @param thread The thread to append.
+   */
+  void pushBack(Thread* thread);
+
+  /**
+   * Removes and returns the first thread of the queue.
+   *
+   * @return The removed thread, or nullptr if the queue is empty.
+   */
+  Thread* popFront();
+
+  /**
+   * Moves all the threads of other, in order, to the end of this queue, leaving other empty.
+   *
+   * @param other The queue to move from.
+   */
+  void spliceBack(ThreadQueue& other);
+
+  /**
+   * Removes all the threads from the queue.
+   */
+  void clear();
+
+  /**
+   * Removes a thread from whichever queue holds it. Has no effect if the thread isn't queued.
+   *
+   * @param thread The thread to remove.
+   */
+  static void unlink(Thread* thread);
+
+  /**
+   * Determines whether a thread is in some queue.
+   *
+   * @param thread The thread to check.
+   * @return True if the thread is queued, false otherwise.
+   */
+  static bool isQueued(Thread* thread);
+};
+
+#endif
@@ -0,0 +1,91 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include "uthreads_internal.h"
+#include "trace.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define SUCCESS 0
+#define NSEC 1000000000ULL
+#define TRACE_START_ERR "Trace error, capacity isn't positive!"
+#define TRACE_WRITE_ERR "Trace error, can't write the trace file!"
+
+bool traceOn = false;
+
+/** traceRing - the ring buffer of events */
+static std::vector<TraceEvent> traceRing;
+
+/** traceCount - the number of events recorded since uthread_trace_start */
+static uint64_t traceCount = 0;
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+void traceAppend (TraceEventType type, int tid, TraceReason reason)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  TraceEvent &event = traceRing[traceCount % traceRing.size ()];
+  event.timestamp_ns = (uint64_t) now.tv_sec * NSEC + now.tv_nsec;
+  event.tid = tid;
+  event.type = type;
+  event.reason = reason;
+  event.padding = 0;
+  traceCount++;
+}
+
+int uthread_trace_start (int capacity)
+{
+  if (capacity <= 0)
+  {
+    err_lib_print (TRACE_START_ERR);
+    return FAILURE;
+  }
+  block_signals_helper ();
+  traceRing.assign (capacity, TraceEvent ());
+  traceCount = 0;
+  traceOn = true;
+  unblock_signals_helper ();
+  return SUCCESS;
+}
+
+void uthread_trace_stop ()
+{
+  traceOn = false;
+}
+
+int uthread_trace_write (const char *path)
+{
+  // Copied with the timer blocked, so the scheduler doesn't append meanwhile.
+  block_signals_helper ();
+  uint64_t size = traceRing.size ();
+  uint64_t count = traceCount < size ? traceCount : size;
+  std::vector<TraceEvent> events;
+  events.reserve (count);
+  for (uint64_t i = traceCount - count; i < traceCount; i++)
+  {
+    events.push_back (traceRing[i % size]);
+  }
+  TraceFileHeader header = {};
+  memcpy (header.magic, TRACE_MAGIC, sizeof (header.magic));
+  header.count = (uint32_t) count;
+  header.overwritten = traceCount - count;
+  unblock_signals_helper ();
+
+  FILE *file = fopen (path, "wb");
+  if (file == nullptr)
+  {
+    err_lib_print (TRACE_WRITE_ERR);
+    return FAILURE;
+  }
+  bool ok = fwrite (&header, sizeof (header), 1, file) == 1
+            && fwrite (events.data (), sizeof (TraceEvent), count, file) == count;
+  if (fclose (file) != 0 || !ok)
+  {
+    err_lib_print (TRACE_WRITE_ERR);
+    return FAILURE;
+  }
+  return (int) count;
+}
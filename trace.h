@@ -0,0 +1,101 @@
+/*
+ * Scheduling event trace for uthreads.
+ *
+ * While tracing, the scheduler records spawn, switch-in, switch-out, resume and wake events into a fixed-size ring
+ * buffer of compact binary records. The buffer can be written to a file and converted to Chrome trace JSON (viewable
+ * in chrome://tracing or Perfetto) with the trace_dump tool. When tracing is off, each hook costs one branch.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <cstdint>
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define TRACE_MAGIC "UTTRACE1" /* first bytes of a trace file */
+
+enum TraceEventType : uint8_t
+{
+  TRACE_SPAWN,        // A thread was created and added to the READY queue
+  TRACE_SWITCH_IN,    // A thread started running
+  TRACE_SWITCH_OUT,   // A thread stopped running, or was terminated, for the reason given
+  TRACE_RESUME,       // A BLOCKED thread was resumed
+  TRACE_WAKE          // A sleeping thread's sleep time ended
+};
+
+enum TraceReason : uint8_t
+{
+  TRACE_NO_REASON,
+  TRACE_PREEMPT,      // The thread's quantum ended
+  TRACE_BLOCK,        // The thread was blocked
+  TRACE_SLEEP,        // The thread went to sleep
+  TRACE_TERMINATE,    // The thread was terminated
+  TRACE_YIELD,        // The thread yielded, or handed its quantum to another thread
+  TRACE_GROUP_BLOCK   // The thread's group was blocked
+};
+
+/** TraceEvent - one binary trace record */
+struct TraceEvent
+{
+  uint64_t timestamp_ns;    // CLOCK_MONOTONIC time of the event
+  int32_t tid;              // The thread the event is about
+  uint8_t type;             // A TraceEventType
+  uint8_t reason;           // A TraceReason, for TRACE_SWITCH_OUT
+  uint16_t padding;
+};
+
+/** TraceFileHeader - the header of a trace file, followed by count TraceEvents, oldest first */
+struct TraceFileHeader
+{
+  char magic[8];
+  uint32_t count;           // The number of events in the file
+  uint32_t padding;
+  uint64_t overwritten;     // The number of older events lost to the ring buffer wrapping around
+};
+
+/* External interface */
+
+/**
+ * @brief Starts tracing into a ring buffer of capacity events, discarding any previous events. Once the buffer is
+ * full, new events overwrite the oldest ones.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_start (int capacity);
+
+/**
+ * @brief Stops tracing. The recorded events are kept until the next uthread_trace_start.
+*/
+void uthread_trace_stop ();
+
+/**
+ * @brief Writes the recorded events to the file at path, in the binary format read by trace_dump.
+ *
+ * @return On success, return the number of events written. On failure, return -1.
+*/
+int uthread_trace_write (const char *path);
+
+/* Hook for the scheduler */
+
+/** traceOn - whether events are being recorded */
+extern bool traceOn;
+
+/**
+ * @brief Appends an event to the ring buffer. Use traceEvent, which skips the call when tracing is off.
+*/
+void traceAppend (TraceEventType type, int tid, TraceReason reason);
+
+/**
+ * @brief Records an event if tracing is on.
+*/
+inline void traceEvent (TraceEventType type, int tid,
+                        TraceReason reason = TRACE_NO_REASON)
+{
+  if (traceOn)
+  {
+    traceAppend (type, tid, reason);
+  }
+}
+
+#endif
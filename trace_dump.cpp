@@ -0,0 +1,179 @@
+/*
+ * trace_dump - converts a trace file written by uthread_trace_write to Chrome trace JSON.
+ *
+ * Usage: trace_dump <trace file> [<json file>]
+ *
+ * Every thread gets its own track, split into "running", "ready", "blocked" and "sleeping" intervals, with instant
+ * markers for spawns, resumes, wakes and the reason of every switch-out. Open the output in chrome://tracing or
+ * https://ui.perfetto.dev.
+ */
+
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "trace.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define USAGE "Usage: trace_dump <trace file> [<json file>]"
+#define READ_ERR "trace_dump: can't read a trace from "
+#define NSEC_PER_USEC 1000.0
+
+/** ThreadTrack - the open interval of a thread's track */
+struct ThreadTrack
+{
+  const char *state;        // The current state, or nullptr before the first event and after termination
+  uint64_t since;           // When the current state started
+};
+
+static const char *reasonName (uint8_t reason)
+{
+  switch (reason)
+  {
+    case TRACE_PREEMPT: return "preempt";
+    case TRACE_BLOCK: return "block";
+    case TRACE_SLEEP: return "sleep";
+    case TRACE_TERMINATE: return "terminate";
+    case TRACE_YIELD: return "yield";
+    case TRACE_GROUP_BLOCK: return "group block";
+    default: return "unknown";
+  }
+}
+
+static const char *reasonState (uint8_t reason)
+{
+  switch (reason)
+  {
+    case TRACE_PREEMPT: return "ready";
+    case TRACE_BLOCK: return "blocked";
+    case TRACE_SLEEP: return "sleeping";
+    case TRACE_YIELD: return "ready";
+    case TRACE_GROUP_BLOCK: return "group blocked";
+    default: return nullptr;
+  }
+}
+
+/**
+Writes one JSON trace event; the first event isn't preceded by a comma.
+*/
+static void writeEvent (std::ostream &out, bool &first, const std::string &body)
+{
+  out << (first ? "\n" : ",\n") << "{" << body << "}";
+  first = false;
+}
+
+static std::string timestamp (uint64_t ns, uint64_t origin)
+{
+  return std::to_string ((ns - origin) / NSEC_PER_USEC);
+}
+
+/**
+Closes the open interval of a track at time now and opens the next state.
+*/
+static void transition (std::ostream &out, bool &first, int tid, ThreadTrack &track,
+                        const char *state, uint64_t now, uint64_t origin)
+{
+  if (track.state != nullptr)
+  {
+    writeEvent (out, first, std::string ("\"name\":\"") + track.state
+                + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string (tid)
+                + ",\"ts\":" + timestamp (track.since, origin)
+                + ",\"dur\":" + std::to_string ((now - track.since) / NSEC_PER_USEC));
+  }
+  track.state = state;
+  track.since = now;
+}
+
+static void instant (std::ostream &out, bool &first, int tid, const std::string &name,
+                     uint64_t now, uint64_t origin)
+{
+  writeEvent (out, first, "\"name\":\"" + name + "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+              + std::to_string (tid) + ",\"ts\":" + timestamp (now, origin));
+}
+
+int main (int argc, char **argv)
+{
+  if (argc < 2 || argc > 3)
+  {
+    std::cerr << USAGE << '\n';
+    return 1;
+  }
+  FILE *file = fopen (argv[1], "rb");
+  TraceFileHeader header;
+  if (file == nullptr || fread (&header, sizeof (header), 1, file) != 1
+      || memcmp (header.magic, TRACE_MAGIC, sizeof (header.magic)) != 0)
+  {
+    std::cerr << READ_ERR << argv[1] << '\n';
+    return 1;
+  }
+  std::vector<TraceEvent> events (header.count);
+  if (fread (events.data (), sizeof (TraceEvent), header.count, file) != header.count)
+  {
+    std::cerr << READ_ERR << argv[1] << '\n';
+    return 1;
+  }
+  fclose (file);
+
+  std::ofstream json_file;
+  if (argc == 3)
+  {
+    json_file.open (argv[2]);
+  }
+  std::ostream &out = argc == 3 ? json_file : std::cout;
+
+  uint64_t origin = events.empty () ? 0 : events.front ().timestamp_ns;
+  std::map<int, ThreadTrack> tracks;
+  bool first = true;
+  out << "{\"otherData\":{\"overwritten\":" << header.overwritten << "},\"traceEvents\":[";
+  for (const TraceEvent &event : events)
+  {
+    auto found = tracks.find (event.tid);
+    if (found == tracks.end ())
+    {
+      found = tracks.insert ({event.tid, {nullptr, event.timestamp_ns}}).first;
+      writeEvent (out, first, "\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                  + std::to_string (event.tid) + ",\"args\":{\"name\":\"uthread "
+                  + std::to_string (event.tid) + "\"}");
+    }
+    ThreadTrack &track = found->second;
+    uint64_t now = event.timestamp_ns;
+    switch (event.type)
+    {
+      case TRACE_SPAWN:
+        instant (out, first, event.tid, "spawn", now, origin);
+        transition (out, first, event.tid, track, "ready", now, origin);
+        break;
+      case TRACE_SWITCH_IN:
+        transition (out, first, event.tid, track, "running", now, origin);
+        break;
+      case TRACE_SWITCH_OUT:
+        instant (out, first, event.tid, reasonName (event.reason), now, origin);
+        transition (out, first, event.tid, track, reasonState (event.reason), now, origin);
+        break;
+      case TRACE_RESUME:
+        instant (out, first, event.tid, "resume", now, origin);
+        if (track.state == nullptr || strcmp (track.state, "blocked") == 0)
+        {
+          transition (out, first, event.tid, track, "ready", now, origin);
+        }
+        break;
+      case TRACE_WAKE:
+        instant (out, first, event.tid, "wake", now, origin);
+        if (track.state == nullptr || strcmp (track.state, "sleeping") == 0)
+        {
+          transition (out, first, event.tid, track, "ready", now, origin);
+        }
+        break;
+    }
+  }
+  uint64_t end = events.empty () ? 0 : events.back ().timestamp_ns;
+  for (auto &track : tracks)
+  {
+    transition (out, first, track.first, track.second, nullptr, end, origin);
+  }
+  out << "\n]}\n";
+  return 0;
+}
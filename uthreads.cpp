@@ -2,25 +2,52 @@
 #include <string>
 #include <iostream>
 #include "uthreads.h"
-#include <queue>
+#include <deque>
+#include <vector>
 #include <signal.h>
 #include <sys/time.h>
 #include <memory>
-#include <map>
 #include "thread.h"
+#include "thread_queue.h"
+#include "uthreads_internal.h"
+#include "mpsc_queue.h"
+#include "profiler.h"
+#include "trace.h"
+#include "basic_scheduler.h"
+#include "index_heap.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <set>
+#include <time.h>
+#include <algorithm>
 
 /** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
 #define FAILURE -1
 #define SUCCESS 0
 #define ANOTHER_THREAD_JUMP 1
 #define MIL 1000000
+#define STACK_ALIGN 16
+#define DISPATCHER_STACK_SIZE 65536
+#define NO_THREAD -1
+#define NSEC_PER_USEC 1000
+#define DEFAULT_BLOCKING_WORKERS 4
+#define NO_SOURCE -1
 #define ERR_LIB_FORMAT "thread library error: "
 #define ERR_SYS_FORMAT "system error: "
 #define INIT_ERR "Init error, quantum isn't positive!"
 #define SPAWN_ERR "Spawn error, max threads or invalid entry_point!"
+#define STACK_ERR "Spawn error, invalid stack size!"
 #define TERMINATE_ERR "terminate error, invalid thread id"
 #define BLOCK_ERR "Block error, illegal tid!"
 #define RESUME_ERR "Resume error, illegal tid!"
+#define GROUP_CREATE_ERR "Group error, max groups!"
+#define GROUP_ERR "Group error, illegal group id!"
+#define GROUP_WAIT_ERR "Group error, a thread can't wait for its own group!"
 #define SIGACTION_ERR "sigaction error."
 #define SETTIMER_ERR "settimer error."
 #define SIGADDSET_ERR "sigaddset error."
@@ -28,34 +55,345 @@
 #define QUANTUM_ERR "quantum error, invalid thread id"
 #define SLEEP_ERR "sleep error, main thread is illegal"
 #define BAD_ALLOC_ERR "bad alloc"
+#define POST_ERR "post error, null function!"
+#define RESUME_ASYNC_ERR "Resume async error, illegal tid!"
+#define EVENTFD_ERR "eventfd error."
+#define IDLE_POLL_ERR "poll error."
+#define BLOCKING_CALL_ERR "Blocking call error, null function!"
+#define BLOCKING_POOL_ERR "Blocking pool error, invalid number of workers!"
+#define PTHREAD_CREATE_ERR "pthread_create error."
+#define WAIT_ERR "Wait error, invalid wake sources!"
+#define WAIT_MAIN_ERR "Wait error, main thread is illegal"
+#define TIMESLICE_ERR "Timeslice error, illegal tid or negative time slice!"
+#define CARRY_OVER_ERR "Carry over error, illegal tid!"
+#define DEADLINE_ERR "Deadline error, illegal tid or negative deadline!"
+#define RESERVATION_ERR "Reservation error, illegal tid or parameters!"
+#define ADMISSION_ERR "Reservation error, not enough CPU for the reservation!"
+#define PERIOD_ERR "Period error, the running thread has no reservation!"
+#define YIELD_ERR "Yield error, illegal tid!"
+#define CANCEL_ERR "Cancel error, illegal tid!"
+#define SNAPSHOT_ERR "Snapshot error, negative number of threads!"
+#define ADAPTIVE_ERR "Adaptive quantum error, invalid bounds or targets!"
+#define TIMER_ERR "Timer error, illegal timer id, interval or callback!"
+#define QUOTA_ERR "Quota error, illegal id or parameters!"
+#define QUOTA_STATS_ERR "Quota error, the scheduler doesn't measure CPU time!"
+#define ADAPTIVE_PERIOD 8
+#define PERMILLE 1000
+#define NSEC_PER_MSEC 1000000
+#define SCHEDULER_STACK_SIZE 65536
 
-/** readyQueue - a vector of shared pointers to threads that are ready to be executed */
-std::deque<std::shared_ptr<Thread>> readyQueue;
+/** readyQueue - the threads that are ready to be executed, in round-robin order */
+ThreadQueue readyQueue;
 
-/** threadsVector - a vector of shared pointers to threads */
-std::vector<std::shared_ptr<Thread>> threadsVector (100, nullptr);
-std::priority_queue<int, std::vector<int>, std::greater<int> > minValidId;
+/** runNext - the thread last resumed by the running thread, scheduled before
+ * readyQueue while runNextOn is set, or nullptr */
+Thread *runNext = nullptr;
+bool runNextOn = false;
 
-/** sleepMap - A map with integer key and value to store the amount of time a
- * thread should sleep before it resumes execution. */
-std::map<int, int> sleep_map;
+/** runNextStreak - the number of consecutive scheduling decisions won by runNext */
+int runNextStreak = 0;
+
+/** dispatcherWoken - set while the dispatcher thread was woken and waits for the
+ * CPU; it runs next after the EDF threads, outside readyQueue and runNext */
+bool dispatcherWoken = false;
+
+/** scheduler - the thread table and free thread IDs */
+uthread_scheduler scheduler;
+
+/** threadsVector - the threads, indexed by ID */
+uthread_scheduler::thread_table<std::shared_ptr<Thread>> &threadsVector = scheduler.threads;
+
+/** sleeping - whether each thread sleeps, sleepQuantums - the number of
+ * quantums it still sleeps for, sleepers - the number of threads sleeping. Kept
+ * in tables rather than a map, since timer ticks update them. */
+uthread_scheduler::thread_table<bool> sleeping;
+uthread_scheduler::thread_table<int> sleepQuantums;
+int sleepers = 0;
 
 /** A shared pointer to the Thread that running now, initially set to  nullptr */
 std::shared_ptr<Thread> running_thread = nullptr;
 
 struct sigaction sa = {};
 struct itimerval timer;
+int quantumUsecs;
 sigset_t blockedSigSet;
 int totalQuantums;
 bool is_blocked = false;
 
+/** QuotaState - the CPU bandwidth quota of a thread or a group */
+struct QuotaState
+{
+  long runtime_ns;            // The CPU time allowed per period, 0 for no quota
+  long period_ns;
+  long used_ns;               // The CPU time used in the current period, beyond runtime_ns while in debt
+  long period_end_ns;         // When the current period ends
+  bool throttled;             // Set when runtime_ns is used up, until the refill at period_end_ns
+  long throttled_since_ns;
+  long throttled_ns;          // The time spent throttled, excluding the current throttle
+};
+
+/** ThreadGroup - threads that are blocked, resumed and terminated together */
+struct ThreadGroup
+{
+  bool used;
+  bool blocked;               // While set, READY members are parked instead of run
+  std::set<int> members;      // The IDs of the live members
+  ThreadQueue parked;         // READY members held back while the group is blocked or throttled
+  std::vector<int> waiters;   // Threads blocked in uthread_group_wait
+  bool cancelled;             // Set by uthread_group_cancel; members spawned later start cancelled
+  int quantums;               // Quantums started by members, including terminated ones
+  long cpu_nsecs;             // CPU time used by members, including terminated ones
+  QuotaState quota;
+};
+
+/** groups - the thread groups, indexed by group ID */
+ThreadGroup groups[MAX_GROUP_NUM];
+
+/** AdaptiveQuantum - the bounds and targets of uthread_set_adaptive_quantum */
+struct AdaptiveQuantum
+{
+  bool on;
+  int min_usecs;
+  int max_usecs;
+  int overhead_permille;      // The share of the CPU switches may take
+  int max_delay_usecs;        // The longest a READY thread should wait, 0 for none
+};
+
+/** adaptive - the adaptive quantum settings, baseQuantumUsecs - the quantum of uthread_init */
+AdaptiveQuantum adaptive = {false, 0, 0, 0, 0};
+int baseQuantumUsecs;
+
+/** switchStartNs - when the scheduling point in progress started, 0 if none is measured */
+long switchStartNs = 0;
+
+/** switchCostNs - the average cost of a scheduling point, from the timer signal
+ * to the next thread running again */
+long switchCostNs = 0;
+
+/** sharedStack - the stack of the threads spawned with uthread_spawn_shared, allocated on first use */
+char *sharedStack = nullptr;
+
+/** sharedOwner - the thread whose frames are on the shared stack, or nullptr. Its
+ * frames are copied out only when another shared thread needs the stack. */
+Thread *sharedOwner = nullptr;
+
+/** SwitchRequest - the arguments of a scheduling point, passed by jumpToThread to schedule */
+struct SwitchRequest
+{
+  bool to_block;
+  bool to_sleep;
+  int handoff;
+  void *context;              // The context interrupted by the timer signal, or nullptr
+};
+
+/** switchRequest - the scheduling point in progress */
+SwitchRequest switchRequest;
+
+/** exitedThread - a thread that terminated itself, freed by schedule once off
+ * its stack */
+std::shared_ptr<Thread> exitedThread = nullptr;
+
+/** schedulerStack - the stack scheduling points run on, schedulerEnv - the
+ * context that enters schedule on it */
+char *schedulerStack = nullptr;
+sigjmp_buf schedulerEnv;
+
+/** sliceStartCpu - CPU time of the OS thread when the running thread's slice started */
+long sliceStartCpu = 0;
+
+/** lastRunNs - the monotonic time each thread last ran, or was spawned */
+uthread_scheduler::thread_table<long> lastRunNs;
+
+/** busyNs - the CPU time each thread used since it last blocked, slept or yielded */
+uthread_scheduler::thread_table<long> busyNs;
+
+/** OffloadJob - a call made by uthread_blocking_call on the offload pool */
+struct OffloadJob
+{
+  blocking_function fn;
+  void *arg;
+  int tid;                    // The calling thread
+  long result;                // fn's return value, set by the worker
+  int err;                    // errno after fn returned, set by the worker
+};
+
+/** InjectedRequest - work submitted from outside the scheduler: the completion
+ * of done when it isn't null, a call of fn(arg) when fn isn't null, and a resume
+ * of tid otherwise */
+struct InjectedRequest
+{
+  posted_function fn;
+  void *arg;
+  int tid;
+  OffloadJob *done;
+};
+
+/** PostedCall - a posted function waiting for the dispatcher thread */
+struct PostedCall
+{
+  posted_function fn;
+  void *arg;
+};
+
+/** TimerState - a timer of uthread_timer_create */
+struct TimerState
+{
+  bool used;
+  posted_function callback;
+  void *arg;
+  long interval_ns;
+  bool periodic;
+  long deadline_ns;           // When the timer expires next
+};
+
+/** timers - the timers, indexed by timer ID, freeTimers - the IDs of the unused ones */
+std::vector<TimerState> timers;
+std::vector<int> freeTimers;
+
+/** timerQueue - the armed timers by expiration, sized with timers, so scheduling
+ * points can check it */
+IndexHeap timerQueue;
+
+/** injectQueue - requests pushed by any OS thread, drained at each scheduling point */
+MpscQueue<InjectedRequest> injectQueue;
+
+/** postedCalls - drained posted functions, run in order by the dispatcher thread */
+std::deque<PostedCall> postedCalls;
+
+/** dispatcherTid - the ID of the thread that drains injectQueue and runs posted
+ * functions, started by uthread_init past the IDs of the user's threads */
+const int dispatcherTid = uthread_scheduler::dispatcher_tid;
+
+/** injectEventFd - signalled by producers while the scheduler waits in uthread_idle_wait */
+int injectEventFd = -1;
+std::atomic<bool> schedulerIdle (false);
+
+/** schedulerThread - the OS thread that runs the library */
+pthread_t schedulerThread;
+
+/** WaitState - the wake sources of a thread blocked in uthread_wait_any */
+struct WaitState
+{
+  const wake_source *sources; // nullptr while the thread isn't waiting
+  int count;
+  int timer;                  // The index of the earliest timer source, or NO_SOURCE
+  int polls;                  // The number of sources that are file descriptors
+  int fired;                  // The index of the source that woke the thread
+};
+
+/** waits - the wait of each thread */
+uthread_scheduler::thread_table<WaitState> waits;
+
+/** waitSources - copies of the wake sources of the shared-stack threads
+ * waiting, whose own arrays leave the stack with their frames */
+uthread_scheduler::thread_table<std::vector<wake_source>> waitSources;
+
+/** pollSources - the number of file descriptor sources of the waiting threads */
+int pollSources = 0;
+
+/** pollFds, pollOwners - the poll set of pollWaiters and the thread and source
+ * of each entry. uthread_wait_any reserves room for every source, so scheduling
+ * points rebuild them without allocating. */
+std::vector<struct pollfd> pollFds;
+std::vector<std::pair<int, int>> pollOwners;
+
+/** DeadlineState - the EDF parameters of a thread and its current job */
+struct DeadlineState
+{
+  int relative_usecs;         // The deadline of each job after its release, 0 for round-robin threads
+  int period_usecs;           // The period of a reservation, 0 for a plain deadline
+  double utilization;         // The CPU share admitted for the reservation
+  long release_ns;            // When the current job was released
+  long deadline_ns;           // The absolute deadline of the current job, 0 between jobs
+  long next_release_ns;       // The release waited for in uthread_wait_next_period, 0 otherwise
+  int misses;                 // The number of jobs that missed their deadline
+  bool demoted;               // Set when the current job missed its deadline, until it completes
+  QuotaState budget;          // The runtime of a reservation, enforced like a quota
+};
+
+/** deadlines - the EDF state of each thread */
+uthread_scheduler::thread_table<DeadlineState> deadlines;
+
+/** deadlineQueue - the READY EDF threads by absolute deadline, scheduled before readyQueue */
+IndexHeap deadlineQueue (uthread_scheduler::table_size);
+
+/** releases - the threads waiting for their next period, by release time */
+IndexHeap releases (uthread_scheduler::table_size);
+
+/** reservedUtilization - the CPU share admitted to all reservations */
+double reservedUtilization = 0;
+
+/** quotas - the CPU quota of each thread */
+uthread_scheduler::thread_table<QuotaState> quotas;
+
+/** throttledThreads - the READY threads held back by their own quota */
+ThreadQueue throttledThreads;
+
+/** refills - the throttled quotas by the end of their period, by quota key: a
+ * thread's quota is keyed by its ID, a group's by groupQuota, and the budget of a
+ * reservation by budgetQuota */
+IndexHeap refills (2 * uthread_scheduler::max_threads + MAX_GROUP_NUM);
+
+/**
+groupQuota - the key of a group's quota in refills
+@param gid: the ID of the group
+@return the key
+*/
+int groupQuota (int gid)
+{
+  return uthread_scheduler::max_threads + gid;
+}
+
+/**
+budgetQuota - the key of the budget of a thread's reservation in refills
+@param tid: the ID of the thread
+@return the key
+*/
+int budgetQuota (int tid)
+{
+  return uthread_scheduler::max_threads + MAX_GROUP_NUM + tid;
+}
+
+/** cancelled - the threads asked to stop with uthread_cancel or uthread_group_cancel */
+uthread_scheduler::thread_table<bool> cancelled;
+
+/** offloadWaits - the blocking call each thread is parked on, or nullptr */
+uthread_scheduler::thread_table<OffloadJob *> offloadWaits;
+
+/** offloadJobs - blocking calls waiting for a worker of the offload pool. The
+ * pthread primitives have no destructors, so exit doesn't wait for idle workers. */
+std::deque<OffloadJob *> offloadJobs;
+pthread_mutex_t offloadMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t offloadCond = PTHREAD_COND_INITIALIZER;
+
+/** offloadWorkers - the number of pool workers started, offloadSize - the number wanted */
+int offloadWorkers = 0;
+int offloadSize = DEFAULT_BLOCKING_WORKERS;
+
 /** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
 
 void removeFromReady (const std::shared_ptr<Thread>& thread);
 int tidCheck (int tid, std::string msg, int floor_tid);
 void timerInitialize (int usecs);
-int uthread_create (thread_entry_point entry_point);
+int uthread_create (thread_entry_point entry_point, int stack_size, int gid,
+                    int tid = NO_THREAD);
 void sleepsQuantumUpdate();
+void drainInjected ();
+void wakeDispatcher ();
+void resumeThread (const std::shared_ptr<Thread> &thread, bool run_next = false);
+void removefromSleeps(int tid);
+void wakeExitWaiters (int tid);
+void cancelWait (int tid);
+void fireWait (int tid, int index);
+long monotonicNow ();
+void startJob (DeadlineState &edf, long release_ns);
+bool pollWaiters (int wake_fd, int timeout_msecs);
+bool handoffReady (int tid);
+void chargeQuota (QuotaState &quota, int owner, long used_ns, long now);
+void setQuota (int owner, int runtime_usecs, int period_usecs);
+void dropQuota (int owner);
+void fireTimers ();
+bool timerDue ();
 
 /**
 uthread_get_tid - gets the ID of the currently running thread
@@ -66,6 +404,16 @@ int uthread_get_tid ()
   return running_thread->getId ();
 }
 
+/**
+threadArena - gets the arena of a thread
+@param tid: the ID of the thread
+@return the thread's arena, or nullptr if no thread with ID tid exists
+*/
+Arena *threadArena (int tid)
+{
+  return threadsVector[tid] != nullptr ? &threadsVector[tid]->arena : nullptr;
+}
+
 /**
 err_lib_print - prints an error message for a library error
 @param err_text: the text of the error message
@@ -105,6 +453,15 @@ int block_signals_helper()
   return EXIT_SUCCESS;
 }
 
+/**
+signalsBlocked - checks if the timer signal is blocked by block_signals_helper
+@return true if the signal is blocked, false otherwise
+*/
+bool signalsBlocked ()
+{
+  return is_blocked;
+}
+
 /**
 unblock_signals_helper - helper function to unblock signals
 @return EXIT_SUCCESS if the signals were successfully unblocked, FAILURE otherwise
@@ -123,380 +480,2864 @@ int unblock_signals_helper(){
 }
 
 /**
-readyQueueIsFull - checks if the ready queue is full
-@return true if the ready queue is full, false otherwise
+threadTableIsFull - checks if all the thread IDs are taken
+@return true if no more threads can be created, false otherwise
 */
-bool readyQueueIsFull ()
+bool threadTableIsFull ()
 {
-  return readyQueue.size () == MAX_THREAD_NUM -1;
+  return scheduler.full ();
 }
 
 /**
-minValidIdInitialize - initializes the minimum valid thread ID queue
+removeFromReady - removes a thread from the ready queue
+@param thread: a shared pointer to the thread to be removed from the ready queue
 @return void
 */
-void minValidIdInitialize ()
+void removeFromReady (const std::shared_ptr<Thread>& thread)
 {
-  for (int i = 0; i < 100; i++)
+  deadlineQueue.erase (thread->getId ());
+  if (runNext == thread.get ())
   {
-    minValidId.push (i);
+    runNext = nullptr;
   }
+  // Also covers a member parked by its group, or a throttled thread.
+  ThreadQueue::unlink (thread.get ());
 }
 
 /**
-removeFromReady - removes a thread from the ready queue
-@param thread: a shared pointer to the thread to be removed from the ready queue
-@return void
+groupHeld - checks if the members of a group must not run: the group is
+ blocked or throttled
+@param gid: the group ID, or NO_GROUP
+@return true if the group holds its members back, false otherwise
 */
-void removeFromReady (const std::shared_ptr<Thread>& thread)
+bool groupHeld (int gid)
 {
-  for (unsigned long i = 0; i < readyQueue.size (); i++)
-  {
-    if (readyQueue[i]->isEqual (thread))
-    {
-      readyQueue.erase (readyQueue.begin () + i);
-    }
-  }
+  return gid != NO_GROUP && (groups[gid].blocked || groups[gid].quota.throttled);
 }
 
 /**
-tidCheck - checks if the given thread ID is valid
-@param tid: the thread ID to check
-@param msg: a message to print if the thread ID is invalid
-@param floor_tid: the minimum valid thread ID
-@return SUCCESS if the thread ID is valid, FAILURE otherwise
+selfThrottled - checks if a thread's own quota or the budget of its reservation
+ is used up
+@param tid: the ID of the thread
+@return true if either is throttled, false otherwise
 */
-int tidCheck (int tid, std::string msg, int floor_tid)
+bool selfThrottled (int tid)
 {
-  std::shared_ptr<Thread> thread = nullptr;
-  if (tid < floor_tid || tid > 99)
-  {
-    err_lib_print (msg);
-    return FAILURE;
-  }
-  if (threadsVector[tid] != nullptr)
-  {
-      thread = threadsVector[tid];
-  }
-  if (thread == nullptr)
-  {
-    err_lib_print (msg);
-    return FAILURE;
-  }
-  return SUCCESS;
+  return quotas[tid].throttled || deadlines[tid].budget.throttled;
 }
 
 /**
-uthread_create - creates a new thread with the given entry point
-@param entry_point: the function to execute when the thread is created
-@return the ID of the new thread, or FAILURE if the creation failed
+heldBack - checks if a READY thread must not run: its group holds it back, or
+ its own quota or reservation is used up
+@param thread: the thread
+@return true if the thread must not run, false otherwise
 */
-int uthread_create (thread_entry_point entry_point)
+bool heldBack (Thread *thread)
 {
-  int threadId = minValidId.top ();
-  minValidId.pop ();
-  std::shared_ptr<Thread> newtThread;
-  try{
-      newtThread = (std::make_shared<Thread> (threadId, entry_point));
-  }
-  catch(std::bad_alloc &e) {
-    err_sys_print (BAD_ALLOC_ERR);
-  }
-  if (entry_point == nullptr)
+  return groupHeld (thread->getGroup ()) || selfThrottled (thread->getId ());
+}
+
+/**
+holdBack - parks a held back READY thread: with its group if the group holds it
+ back, with the throttled threads otherwise
+@param thread: the thread
+@return void
+*/
+void holdBack (Thread *thread)
+{
+  if (groupHeld (thread->getGroup ()))
   {
-    running_thread = newtThread;
-    newtThread->setState (RUNNING);
+    groups[thread->getGroup ()].parked.pushBack (thread);
   }
   else
-  { readyQueue.push_back (newtThread);
+  {
+    throttledThreads.pushBack (thread);
   }
-  threadsVector[threadId] = newtThread;
-  return threadId;
 }
 
 /**
- * Clears all data structures used by the thread scheduler.
- * This includes the ready queue, the vector of all threads, and the sleep map.
- */
-void Clear_database()
+demoteLate - ends the job of an EDF thread as a miss once its deadline passed,
+ so the rest of the job runs round-robin until the thread gives up the CPU
+@param edf: the thread's EDF state
+@return true if the current job is demoted, false otherwise
+*/
+bool demoteLate (DeadlineState &edf)
 {
-  readyQueue.clear();
-  threadsVector.clear();
-  sleep_map.clear();
+  if (!edf.demoted && edf.deadline_ns != 0 && monotonicNow () > edf.deadline_ns)
+  {
+    edf.misses++;
+    edf.deadline_ns = 0;
+    edf.demoted = true;
+  }
+  return edf.demoted;
 }
 
-
 /**
- * Switches execution from the current running thread to the next thread in the ready queue.
- *
- * @param to_block A boolean indicating whether the current thread should be blocked.
- * @param to_sleep A boolean indicating whether the current thread should be put to sleep.
- */
-void jumpToThread (bool to_block, bool to_sleep)
+makeReady - appends a READY thread to the ready queue, or parks it if its group
+ is blocked or throttled, or it is throttled. An EDF thread whose job is late
+ goes to the ready queue.
+@param thread: the thread to append
+@param run_next: whether a round-robin thread goes to the run-next slot instead,
+ pushing the thread there to the end of the ready queue
+@return void
+*/
+void makeReady (const std::shared_ptr<Thread>& thread, bool run_next = false)
 {
-  sleepsQuantumUpdate();
-  totalQuantums++;
-
-  if (readyQueue.empty())
+  if (heldBack (thread.get ()))
   {
-    running_thread->incrementQuantum();
-    return;
+    holdBack (thread.get ());
   }
-  if (running_thread != nullptr && !to_block)
+  else if (deadlines[thread->getId ()].relative_usecs > 0
+           && !demoteLate (deadlines[thread->getId ()]))
   {
-    running_thread->setState(READY);
-    if (!to_sleep){
-      readyQueue.push_back (running_thread);
+    DeadlineState &edf = deadlines[thread->getId ()];
+    if (edf.deadline_ns == 0)
+    {
+      startJob (edf, monotonicNow ());
     }
+    deadlineQueue.push (thread->getId (), edf.deadline_ns);
   }
-  if (to_block){
-    running_thread->setState(BLOCKED);
+  else if (run_next && uthread_scheduler::run_next_limit > 0)
+  {
+    if (runNext != nullptr)
+    {
+      readyQueue.pushBack (runNext);
+    }
+    runNext = thread.get ();
   }
-
-  std::shared_ptr<Thread> &nextThread = readyQueue.front ();
-  readyQueue.pop_front ();
-  nextThread->setState (RUNNING);
-  running_thread = nextThread;
-  running_thread->incrementQuantum();
-  if (setitimer (ITIMER_VIRTUAL, &timer, NULL) < 0)
+  else
   {
-    err_sys_print (SETTIMER_ERR);
+    readyQueue.pushBack (thread.get ());
   }
-  siglongjmp (running_thread->env, ANOTHER_THREAD_JUMP);
+}
 
+/**
+nothingReady - checks if no thread is ready to run
+@return true if both the deadline queue and the ready queue are empty
+*/
+bool nothingReady ()
+{
+  return deadlineQueue.empty () && !dispatcherWoken && runNext == nullptr
+         && readyQueue.empty ();
 }
 
 /**
- * Signal handler function for the virtual timer.
- * This function switches execution from the current running thread to the next thread in the ready queue.
- *
- * @param sig The signal number.
- */
-void timer_handler (int sig)
+popNext - takes the next thread to run: the READY thread with the earliest
+ deadline, or if no EDF thread is READY, the woken dispatcher, the run-next
+ thread, or the front of the ready queue
+@return the thread
+*/
+Thread *popNext ()
 {
-  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
-  if (ret_val == 0)
+  if (!deadlineQueue.empty ())
   {
-    jumpToThread(false, false);
+    int tid = deadlineQueue.top ();
+    deadlineQueue.pop ();
+    return threadsVector[tid].get ();
+  }
+  if (dispatcherWoken)
+  {
+    dispatcherWoken = false;
+    return threadsVector[dispatcherTid].get ();
+  }
+  if (runNext != nullptr)
+  {
+    Thread *next = runNext;
+    runNext = nullptr;
+    if (runNextStreak < uthread_scheduler::run_next_limit)
+    {
+      runNextStreak++;
+      return next;
+    }
+    // The queue's turn: threads resuming each other can't starve it.
+    readyQueue.pushBack (next);
   }
+  runNextStreak = 0;
+  return readyQueue.popFront ();
 }
 
 /**
-timerInitialize - initializes the timer that determines the time quantum for each thread
-@param usecs: the time in microseconds for each quantum
+parkBlockedGroups - moves the held back threads from the front of the ready
+ queue to their groups' parked queues or the throttled threads, so the front
+ can be scheduled. Blocking or throttling a group only sets its flag; its
+ members leave the ready queue here, lazily, when they reach the front.
 @return void
 */
-void timerInitialize (int quantum_usecs)
+void parkBlockedGroups ()
 {
-  // Install timer_handler as the signal handler for SIGVTALRM.
-  sa.sa_handler = &timer_handler;
-  if (sigaction (SIGVTALRM, &sa, NULL) < 0)
+  Thread *front;
+  while ((front = readyQueue.front ()) != nullptr && heldBack (front))
   {
-    err_sys_print (SIGACTION_ERR);
+    readyQueue.popFront ();
+    holdBack (front);
   }
-  if (sigaddset (&blockedSigSet, SIGVTALRM) < 0)
+  if (runNext != nullptr && heldBack (runNext))
   {
-    err_sys_print (SIGADDSET_ERR);
+    holdBack (runNext);
+    runNext = nullptr;
   }
-
-  timer.it_value.tv_sec = quantum_usecs/MIL;
-  timer.it_value.tv_usec = quantum_usecs%MIL;
-
-  timer.it_interval.tv_sec = quantum_usecs/MIL;
-  timer.it_interval.tv_usec = quantum_usecs%MIL;
-
-  if (setitimer (ITIMER_VIRTUAL, &timer, NULL) < 0)
+  while (!deadlineQueue.empty ())
   {
-    err_sys_print (SETTIMER_ERR);
+    front = threadsVector[deadlineQueue.top ()].get ();
+    if (!heldBack (front))
+    { break; }
+    deadlineQueue.pop ();
+    holdBack (front);
   }
+}
 
+/**
+groupCheck - checks if the given group ID is valid
+@param gid: the group ID to check
+@return SUCCESS if the group exists, FAILURE otherwise
+*/
+int groupCheck (int gid)
+{
+  if (gid < 0 || gid >= MAX_GROUP_NUM || !groups[gid].used)
+  {
+    err_lib_print (GROUP_ERR);
+    return FAILURE;
+  }
+  return SUCCESS;
 }
 
 /**
-sleepsQuantumUpdate - updates the sleep time of each thread in the sleep queue
- and wakes up the threads that finish their times
+leaveGroup - removes a terminated thread from its group, resuming the threads
+ waiting for the group once it has no members left
+@param thread: the terminated thread
 @return void
 */
-void sleepsQuantumUpdate()
+void leaveGroup (const std::shared_ptr<Thread>& thread)
 {
-  auto it = sleep_map.begin();
-  while (it != sleep_map.end()) {
-    if (it->second == 0)
+  int gid = thread->getGroup ();
+  if (gid == NO_GROUP)
+  { return; }
+  thread->setGroup (NO_GROUP);
+  ThreadGroup &group = groups[gid];
+  group.members.erase (thread->getId ());
+  if (group.members.empty ())
+  {
+    for (int waiter : group.waiters)
     {
-      std::shared_ptr<Thread> &weakup_thread = threadsVector[it->first];
-      if(weakup_thread->getState() != BLOCKED){
-        weakup_thread->setState(READY);
-        readyQueue.push_back (weakup_thread);
+      if (threadsVector[waiter] != nullptr)
+      {
+        resumeThread (threadsVector[waiter]);
       }
-      it = sleep_map.erase (it);
-    }
-    else
-    {
-      it->second --;
-      ++it;
     }
+    group.waiters.clear ();
   }
 }
 
 /**
-Removes an entry from the sleep_map based on the given thread ID.
-@param tid Thread ID to remove from the sleep_map
+cpuNow - reads the CPU time used by the OS thread running the library
+@return the CPU time in nanoseconds
 */
-void removefromSleeps(int tid){
-  auto it = sleep_map.begin();
-  while (it != sleep_map.end())
-  {
-    if (it->first == tid){
-      it = sleep_map.erase (it);
-    }
-    else{
-      ++it;
-    }
-  }
+long cpuNow ()
+{
+  struct timespec now;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * (long) MIL * 1000 + now.tv_nsec;
 }
 
-
-/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
-
-int uthread_init (int quantum_usecs)
+/**
+chargeCpu - charges the CPU time since the last switch to the thread that was
+ running and its group, and their quotas, and starts measuring the next slice
+@param thread: the thread that used the CPU
+@return void
+*/
+void chargeCpu (const std::shared_ptr<Thread>& thread)
 {
-  if (quantum_usecs <= 0)
+  if (!uthread_scheduler::stats)
+  { return; }
+  long now = cpuNow ();
+  long used = now - sliceStartCpu;
+  int tid = thread->getId ();
+  int gid = thread->getGroup ();
+  busyNs[tid] += used;
+  lastRunNs[tid] = monotonicNow ();
+  chargeQuota (quotas[tid], tid, used, lastRunNs[tid]);
+  chargeQuota (deadlines[tid].budget, budgetQuota (tid), used, lastRunNs[tid]);
+  if (gid != NO_GROUP)
   {
-    err_lib_print (INIT_ERR);
-    return FAILURE;
+    groups[gid].cpu_nsecs += used;
+    chargeQuota (groups[gid].quota, groupQuota (gid), used, lastRunNs[tid]);
   }
-  minValidIdInitialize ();
-  timerInitialize (quantum_usecs);
-  uthread_create (nullptr);
-  totalQuantums = 1;
-  return SUCCESS;
+  sliceStartCpu = now;
+}
 
+/**
+monotonicNow - reads the monotonic clock that deadlines are measured on
+@return the time in nanoseconds
+*/
+long monotonicNow ()
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * (long) MIL * NSEC_PER_USEC + now.tv_nsec;
 }
 
-int uthread_spawn (thread_entry_point entry_point)
+/**
+startJob - releases a new job of an EDF thread
+@param edf: the thread's EDF state
+@param release_ns: the release time of the job
+@return void
+*/
+void startJob (DeadlineState &edf, long release_ns)
 {
-  block_signals_helper();
-  if (entry_point == nullptr || readyQueueIsFull ())
+  edf.release_ns = release_ns;
+  edf.deadline_ns = release_ns + (long) edf.relative_usecs * NSEC_PER_USEC;
+}
+
+/**
+endJob - completes the current job of a thread that gives up the CPU, counting
+ a miss if it completes after its deadline
+@param tid: the ID of the thread
+@return void
+*/
+void endJob (int tid)
+{
+  DeadlineState &edf = deadlines[tid];
+  edf.demoted = false;
+  if (edf.deadline_ns == 0)
+  { return; }
+  if (monotonicNow () > edf.deadline_ns)
   {
-    err_lib_print (SPAWN_ERR);
-    unblock_signals_helper();
-    return FAILURE;
+    edf.misses++;
   }
-  int id = uthread_create(entry_point);
-  unblock_signals_helper();
-  return id;
+  edf.deadline_ns = 0;
 }
 
-int uthread_terminate (int tid)
+/**
+dropRelease - forgets the next period a thread waits for in
+ uthread_wait_next_period, if any
+@param tid: the ID of the thread
+@return void
+*/
+void dropRelease (int tid)
+{
+  DeadlineState &edf = deadlines[tid];
+  if (edf.next_release_ns == 0)
+  { return; }
+  releases.erase (tid);
+  edf.next_release_ns = 0;
+}
+
+/**
+clearDeadline - drops the EDF state of a terminated thread, returning its
+ reserved CPU share. The thread must not be in the deadline queue.
+@param tid: the ID of the thread
+@return void
+*/
+void clearDeadline (int tid)
+{
+  DeadlineState &edf = deadlines[tid];
+  reservedUtilization -= edf.utilization;
+  dropRelease (tid);
+  dropQuota (budgetQuota (tid));
+  edf = DeadlineState ();
+}
+
+/**
+refillBudget - gives a reservation its full runtime for a new job, the budget
+ period starting at the job's release
+@param tid: the ID of the thread
+@param release_ns: the release time of the job
+@return void
+*/
+void refillBudget (int tid, long release_ns)
+{
+  QuotaState &budget = deadlines[tid].budget;
+  if (budget.runtime_ns == 0)
+  { return; }
+  dropQuota (budgetQuota (tid));
+  budget.used_ns = 0;
+  budget.period_end_ns = release_ns + budget.period_ns;
+}
+
+/**
+releaseDue - releases the jobs of the periodic threads whose next period
+ started, moving them to the deadline queue
+@return void
+*/
+void releaseDue ()
+{
+  if (releases.empty ())
+  { return; }
+  long now = monotonicNow ();
+  while (!releases.empty () && releases.topKey () <= now)
+  {
+    long release_ns = releases.topKey ();
+    int tid = releases.top ();
+    releases.pop ();
+    DeadlineState &edf = deadlines[tid];
+    edf.next_release_ns = 0;
+    startJob (edf, release_ns);
+    refillBudget (tid, release_ns);
+    resumeThread (threadsVector[tid]);
+  }
+}
+
+/**
+quotaOf - finds a quota by its key in refills
+@param owner: a thread ID, a groupQuota or a budgetQuota
+@return the quota
+*/
+QuotaState &quotaOf (int owner)
+{
+  if (owner < uthread_scheduler::max_threads)
+  { return quotas[owner]; }
+  if (owner < budgetQuota (0))
+  { return groups[owner - groupQuota (0)].quota; }
+  return deadlines[owner - budgetQuota (0)].budget;
+}
+
+/**
+chargeQuota - charges CPU time to a quota, throttling it once its runtime is
+ used up. A period starts with the first charge after the previous one ended,
+ so only throttled quotas need a refill.
+@param quota: the quota
+@param owner: the key of the quota in refills
+@param used_ns: the CPU time used
+@param now: the monotonic time
+@return void
+*/
+void chargeQuota (QuotaState &quota, int owner, long used_ns, long now)
+{
+  if (quota.runtime_ns == 0 || quota.throttled)
+  { return; }
+  if (now >= quota.period_end_ns)
+  {
+    quota.used_ns = 0;
+    quota.period_end_ns = now + quota.period_ns;
+  }
+  quota.used_ns += used_ns;
+  if (quota.used_ns >= quota.runtime_ns)
+  {
+    quota.throttled = true;
+    quota.throttled_since_ns = now;
+    refills.push (owner, quota.period_end_ns);
+  }
+}
+
+/**
+releaseQuota - lets the threads held back by a quota that is no longer
+ throttled run again
+@param owner: the key of the quota in refills
+@return void
+*/
+void releaseQuota (int owner)
+{
+  if (owner >= groupQuota (0) && owner < budgetQuota (0))
+  {
+    ThreadGroup &group = groups[owner - groupQuota (0)];
+    if (!group.blocked)
+    {
+      readyQueue.spliceBack (group.parked);
+    }
+    return;
+  }
+  int tid = owner < uthread_scheduler::max_threads ? owner : owner - budgetQuota (0);
+  Thread *thread = threadsVector[tid].get ();
+  // A member of a held back group stays parked with its group, and a thread
+  // still held back by its other quota stays with the throttled threads.
+  if (thread != nullptr && thread->getState () == READY
+      && ThreadQueue::isQueued (thread) && !heldBack (thread))
+  {
+    ThreadQueue::unlink (thread);
+    makeReady (threadsVector[tid]);
+  }
+}
+
+/**
+dropQuota - removes a quota, ending its throttle, if any. Doesn't release the
+ threads it held back.
+@param owner: the key of the quota in refills
+@return void
+*/
+void dropQuota (int owner)
+{
+  QuotaState &quota = quotaOf (owner);
+  if (quota.throttled)
+  {
+    refills.erase (owner);
+    quota.throttled = false;
+    quota.throttled_ns += monotonicNow () - quota.throttled_since_ns;
+  }
+  quota.runtime_ns = 0;
+}
+
+/**
+refillDue - refills the throttled quotas whose period ended, releasing the
+ threads they held back. Takes O(throttled quotas due), however many threads
+ have a quota.
+@return void
+*/
+void refillDue ()
+{
+  if (refills.empty ())
+  { return; }
+  long now = monotonicNow ();
+  while (!refills.empty () && refills.topKey () <= now)
+  {
+    int owner = refills.top ();
+    refills.pop ();
+    QuotaState &quota = quotaOf (owner);
+    // Time used past the runtime, up to a timer tick, is paid back from the next period.
+    quota.used_ns = std::max (quota.used_ns - quota.runtime_ns, 0L);
+    quota.period_end_ns += quota.period_ns;
+    if (quota.used_ns >= quota.runtime_ns)
+    {
+      refills.push (owner, quota.period_end_ns);
+      continue;
+    }
+    quota.throttled = false;
+    quota.throttled_ns += now - quota.throttled_since_ns;
+    releaseQuota (owner);
+  }
+}
+
+/**
+idleTimeout - shortens the timeout of an idle wait so it ends by the next
+ refill, release of a periodic job or timer expiration, since the timer signal
+ doesn't come while the process is idle
+@param timeout_msecs: the timeout asked for, negative to wait forever
+@return the timeout to wait with
+*/
+int idleTimeout (int timeout_msecs)
+{
+  const IndexHeap *heaps[] = {&refills, &releases, &timerQueue};
+  long next = -1;
+  for (const IndexHeap *heap : heaps)
+  {
+    if (!heap->empty () && (next == -1 || heap->topKey () < next))
+    { next = heap->topKey (); }
+  }
+  if (next == -1)
+  { return timeout_msecs; }
+  long wait = (next - monotonicNow () + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+  wait = std::max (wait, 0L);
+  return timeout_msecs < 0 || wait < timeout_msecs ? (int) wait : timeout_msecs;
+}
+
+/**
+quotaLeft - the CPU time a thread may use before its own quota, its
+ reservation or its group's quota throttles it
+@param thread: the thread
+@return the time in microseconds, or 0 if none has runtime left to limit
+*/
+int quotaLeft (Thread *thread)
+{
+  const QuotaState *limits[] = {&quotas[thread->getId ()],
+                                &deadlines[thread->getId ()].budget,
+                                thread->getGroup () != NO_GROUP
+                                ? &groups[thread->getGroup ()].quota : nullptr};
+  long left = 0;
+  for (const QuotaState *quota : limits)
+  {
+    if (quota == nullptr || quota->runtime_ns == 0 || quota->throttled)
+    { continue; }
+    long now = monotonicNow ();
+    long quota_left = now >= quota->period_end_ns ? quota->runtime_ns
+                                                  : quota->runtime_ns - quota->used_ns;
+    if (left == 0 || quota_left < left)
+    {
+      left = quota_left;
+    }
+  }
+  return left > 0 ? (int) std::max (left / NSEC_PER_USEC, 1L) : 0;
+}
+
+/**
+startQuantum - counts a new quantum for a thread and its group
+@param thread: the thread starting a quantum
+@return void
+*/
+void startQuantum (const std::shared_ptr<Thread>& thread)
+{
+  thread->incrementQuantum ();
+  if (thread->getGroup () != NO_GROUP)
+  {
+    groups[thread->getGroup ()].quantums++;
+  }
+}
+
+/**
+threadSlice - the length of a thread's quantums
+@param thread: the thread
+@return the thread's time slice in microseconds
+*/
+int threadSlice (const std::shared_ptr<Thread>& thread)
+{
+  return thread->getTimeslice () > 0 ? thread->getTimeslice () : quantumUsecs;
+}
+
+/**
+armTimer - starts the timer for a quantum of the thread about to run: its own
+ time slice, plus any time it carried over from a quantum that ended early, cut
+ short to the runtime left in its quotas
+@param thread: the thread about to run
+@return void
+*/
+void armTimer (const std::shared_ptr<Thread>& thread)
+{
+  int slice = threadSlice (thread);
+  int first = slice + thread->getCarried ();
+  thread->setCarried (0);
+  // Ending the quantum when a quota runs out keeps the overrun within a timer tick.
+  int left = quotaLeft (thread.get ());
+  if (left > 0 && left < first)
+  {
+    first = left;
+  }
+  timer.it_value.tv_sec = first / MIL;
+  timer.it_value.tv_usec = first % MIL;
+  // Reloaded when the quantum ends with no other thread READY.
+  timer.it_interval.tv_sec = slice / MIL;
+  timer.it_interval.tv_usec = slice % MIL;
+  if (setitimer (ITIMER_VIRTUAL, &timer, NULL) < 0)
+  {
+    err_sys_print (SETTIMER_ERR);
+  }
+}
+
+/**
+saveUnusedSlice - keeps the unused time of a quantum that ends early for the
+ thread's next quantum, if the thread carries time over
+@param thread: the thread giving up the CPU
+@return void
+*/
+void saveUnusedSlice (const std::shared_ptr<Thread>& thread)
+{
+  if (!thread->getCarryOver ())
+  { return; }
+  struct itimerval left;
+  if (getitimer (ITIMER_VIRTUAL, &left) < 0)
+  {
+    err_sys_print (SETTIMER_ERR);
+  }
+  int unused = (int) (left.it_value.tv_sec * MIL + left.it_value.tv_usec);
+  // At most one slice is carried, so a thread can't hoard time.
+  thread->setCarried (unused < threadSlice (thread) ? unused : threadSlice (thread));
+}
+
+/**
+forgetSharedStack - drops the frames of a terminated thread from the shared
+ stack, so they aren't copied out
+@param thread: the terminated thread
+@return void
+*/
+void forgetSharedStack (Thread *thread)
+{
+  if (sharedOwner == thread)
+  {
+    sharedOwner = nullptr;
+  }
+}
+
+/**
+freeThread - drops the last reference to a terminated thread, freeing its arena
+ and stack. Called with the timer signal blocked, off the thread's stack.
+@param thread: the reference, reset to nullptr
+@return void
+*/
+void freeThread (std::shared_ptr<Thread> &thread)
+{
+  thread->arena.release ();
+  thread = nullptr;
+}
+
+/**
+releaseThread - removes a thread that isn't running from all the control
+ structures and frees its ID
+@param tid: the ID of the thread
+@return void
+*/
+void releaseThread (int tid)
+{
+  removeFromReady (threadsVector[tid]);
+  clearDeadline (tid);
+  dropQuota (tid);
+  forgetSharedStack (threadsVector[tid].get ());
+  removefromSleeps (tid);
+  cancelWait (tid);
+  uthread_scheduler::trace (TRACE_SWITCH_OUT, tid, TRACE_TERMINATE);
+  wakeExitWaiters (tid);
+  // A blocking call still running is freed by drainInjected when it completes.
+  offloadWaits[tid] = nullptr;
+  threadsVector[tid] = nullptr;
+  scheduler.releaseId (tid);
+}
+
+/**
+tidCheck - checks if the given thread ID is valid
+@param tid: the thread ID to check
+@param msg: a message to print if the thread ID is invalid
+@param floor_tid: the minimum valid thread ID
+@return SUCCESS if the thread ID is valid, FAILURE otherwise
+*/
+int tidCheck (int tid, std::string msg, int floor_tid)
+{
+  std::shared_ptr<Thread> thread = nullptr;
+  if (tid < floor_tid || !uthread_scheduler::validTid (tid))
+  {
+    err_lib_print (msg);
+    return FAILURE;
+  }
+  if (threadsVector[tid] != nullptr)
+  {
+      thread = threadsVector[tid];
+  }
+  if (thread == nullptr)
+  {
+    err_lib_print (msg);
+    return FAILURE;
+  }
+  return SUCCESS;
+}
+
+/**
+switchDone - ends the measure of a scheduling point, if one is measured, and
+ adds it to the average switch cost
+@return void
+*/
+void switchDone ()
+{
+  if (switchStartNs == 0)
+  { return; }
+  long cost = monotonicNow () - switchStartNs;
+  switchStartNs = 0;
+  switchCostNs = switchCostNs == 0 ? cost : switchCostNs + (cost - switchCostNs) / ADAPTIVE_PERIOD;
+}
+
+/**
+tuneQuantum - sets the quantum used by threads without their own time slice
+ from the measured switch cost and the number of READY threads: as short as
+ the queueing delay target asks, but long enough that switches stay within
+ the overhead target, and within the user's bounds
+@return void
+*/
+void tuneQuantum ()
+{
+  int depth = 0;
+  for (int tid = 0; tid < uthread_scheduler::max_threads; tid++)
+  {
+    if (threadsVector[tid] != nullptr && handoffReady (tid))
+    {
+      depth++;
+    }
+  }
+  long quantum = adaptive.max_usecs;
+  if (adaptive.max_delay_usecs > 0 && depth > 0)
+  {
+    quantum = adaptive.max_delay_usecs / depth;
+  }
+  // The overhead target wins over the delay target.
+  long floor = switchCostNs * PERMILLE / adaptive.overhead_permille / NSEC_PER_USEC;
+  quantum = std::max (quantum, std::max (floor, (long) adaptive.min_usecs));
+  quantumUsecs = (int) std::min (quantum, (long) adaptive.max_usecs);
+}
+
+/**
+signalsRestoreAfterJump - re-enables the timer signal in a thread that was
+ switched out while holding it blocked and has just been jumped back into
+@return void
+*/
+void signalsRestoreAfterJump ()
+{
+  is_blocked = true;
+  switchDone ();
+  unblock_signals_helper();
+}
+
+/**
+threadStart - the code every spawned thread starts with: re-enables the timer
+ and runs the thread's entry point
+@return void
+*/
+void threadStart ()
+{
+  signalsRestoreAfterJump();
+  running_thread->getEntryPoint () ();
+}
+
+/**
+spawnThread - creates a thread for the spawn functions, which block the timer
+ signal around it
+@param entry_point: the function the thread runs
+@param stack_size: the size of the thread's stack in bytes
+@param gid: the group of the new thread, or NO_GROUP
+@return the ID of the new thread, or FAILURE if the entry point is null or the
+ thread table is full
+*/
+int spawnThread (thread_entry_point entry_point, int stack_size, int gid)
+{
+  if (entry_point == nullptr || threadTableIsFull ())
+  {
+    err_lib_print (SPAWN_ERR);
+    return FAILURE;
+  }
+  return uthread_create (entry_point, stack_size, gid);
+}
+
+/**
+uthread_create - creates a new thread with the given entry point
+@param entry_point: the function to execute when the thread is created
+@param stack_size: the size of the new thread's stack in bytes, or SHARED_STACK
+@param gid: the group of the new thread, or NO_GROUP
+@param tid: the ID of the new thread, outside the pool of free IDs, or NO_THREAD
+ for the smallest free one
+@return the ID of the new thread, or FAILURE if the creation failed
+*/
+int uthread_create (thread_entry_point entry_point, int stack_size, int gid,
+                    int tid)
+{
+  int threadId = tid != NO_THREAD ? tid : scheduler.takeId ();
+  std::shared_ptr<Thread> newtThread;
+  try{
+      if (stack_size == SHARED_STACK && sharedStack == nullptr)
+      {
+        sharedStack = new char[uthread_scheduler::shared_stack_size];
+      }
+      newtThread = stack_size == SHARED_STACK
+                   ? std::make_shared<Thread> (threadId, entry_point,
+                                               uthread_scheduler::shared_stack_size,
+                                               threadStart, sharedStack)
+                   : std::make_shared<Thread> (threadId, entry_point, stack_size,
+                                               threadStart);
+  }
+  catch(std::bad_alloc &e) {
+    err_sys_print (BAD_ALLOC_ERR);
+  }
+  cancelled[threadId] = gid != NO_GROUP && groups[gid].cancelled;
+  lastRunNs[threadId] = uthread_scheduler::stats ? monotonicNow () : 0;
+  busyNs[threadId] = 0;
+  quotas[threadId] = QuotaState ();
+  if (entry_point == nullptr)
+  {
+    running_thread = newtThread;
+    newtThread->setState (RUNNING);
+  }
+  else
+  {
+    // Like every other saved context, a new thread is entered with the timer
+    // blocked, so no tick can land inside siglongjmp; threadStart unblocks it.
+    sigaddset (&newtThread->env->__saved_mask, SIGVTALRM);
+    if (gid != NO_GROUP)
+    {
+      newtThread->setGroup (gid);
+      groups[gid].members.insert (threadId);
+    }
+    makeReady (newtThread);
+    uthread_scheduler::trace (TRACE_SPAWN, threadId);
+  }
+  threadsVector[threadId] = newtThread;
+  return threadId;
+}
+
+/**
+ * Clears all data structures used by the thread scheduler.
+ * This includes the ready queue, the vector of all threads, and the sleep map.
+ */
+void Clear_database()
+{
+  readyQueue.clear();
+  runNext = nullptr;
+  dispatcherWoken = false;
+  threadsVector.fill (nullptr);
+  sleeping.fill (false);
+  sleepers = 0;
+}
+
+
+/**
+handoffReady - checks if a thread can take a directed yield: it is READY in the
+ ready queue or the deadline queue, and neither it nor its group is held back
+@param tid: the ID of the thread
+@return true if the thread can run next, false otherwise
+*/
+bool handoffReady (int tid)
+{
+  const std::shared_ptr<Thread> &thread = threadsVector[tid];
+  if (thread->getState () != READY || heldBack (thread.get ()))
+  { return false; }
+  return ThreadQueue::isQueued (thread.get ()) || runNext == thread.get ()
+         || deadlineQueue.contains (tid);
+}
+
+/**
+onSharedStack - checks if an address is on the shared stack
+@param address: the address
+@return true if the address is inside the shared stack, false otherwise
+*/
+bool onSharedStack (const char *address)
+{
+  return sharedStack != nullptr && address >= sharedStack
+         && address < sharedStack + uthread_scheduler::shared_stack_size;
+}
+
+/**
+markSharedSp - records where the frames of the running thread end, if it is
+ switching out of the shared stack
+@return void
+*/
+__attribute__ ((noinline)) void markSharedSp ()
+{
+  char here = 0;
+  if (onSharedStack (&here))
+  {
+    sharedOwner->setSharedSp (&here);
+  }
+}
+
+/**
+giveSharedStack - gives the shared stack to the running thread, about to be
+ jumped into: copies out the frames of the thread on the stack, then copies the
+ running thread's frames back
+@return void
+*/
+void giveSharedStack ()
+{
+  if (sharedOwner != nullptr)
+  {
+    sharedOwner->saveStack ();
+  }
+  sharedOwner = running_thread.get ();
+  running_thread->restoreStack ();
+}
+
+/**
+schedule - the scheduling point requested by jumpToThread, run on the scheduler
+ stack: picks the next thread and jumps into it, or back into the running thread
+ if no other thread is ready. Entered with the timer signal blocked; doesn't return.
+ Reached from the timer signal handler, so it follows the heap rule of uthreads_internal.h.
+@return void
+*/
+__attribute__ ((noreturn)) void schedule ()
+{
+  if (exitedThread != nullptr)
+  {
+    // Requested by uthread_terminate rather than the handler, so the heap is safe.
+    freeThread (exitedThread);
+  }
+  bool to_block = switchRequest.to_block;
+  bool to_sleep = switchRequest.to_sleep;
+  int handoff = switchRequest.handoff;
+  if (switchRequest.context != nullptr)
+  {
+    if (running_thread->getId () == 0)
+    {
+      // The main thread runs on the OS thread's own stack.
+      profilerSample (0, switchRequest.context, nullptr, nullptr);
+    }
+    else
+    {
+      profilerSample (running_thread->getId (), switchRequest.context,
+                      running_thread->getStack (),
+                      running_thread->getStack ()
+                      + running_thread->getStackSize ());
+    }
+  }
+  if (adaptive.on)
+  {
+    switchStartNs = monotonicNow ();
+  }
+  // Blocked before draining, so an injected resume of this thread isn't lost.
+  if (to_block){
+    running_thread->setState(BLOCKED);
+    saveUnusedSlice (running_thread);
+    endJob (running_thread->getId ());
+  }
+  if (running_thread != nullptr)
+  {
+    chargeCpu (running_thread);
+  }
+  if (to_block)
+  {
+    busyNs[running_thread->getId ()] = 0;
+  }
+  if (!injectQueue.empty ())
+  {
+    // Draining frees the queue's nodes, so it is left to the dispatcher.
+    wakeDispatcher ();
+  }
+  releaseDue ();
+  refillDue ();
+  if (timerDue ())
+  {
+    wakeDispatcher ();
+  }
+  if (pollSources > 0)
+  {
+    pollWaiters (-1, 0);
+  }
+  // The dispatcher's runs aren't quantums of their own, so posted work doesn't
+  // shift the total or the sleepers: switching out of it doesn't count, nor
+  // does a yield that only found the dispatcher READY, which would have gone on
+  // in the same quantum without it.
+  parkBlockedGroups ();
+  bool yielding = !to_block && !to_sleep && switchRequest.context == nullptr
+                  && running_thread != nullptr;
+  bool dispatchOnly = dispatcherWoken && deadlineQueue.empty () && runNext == nullptr
+                      && readyQueue.empty ();
+  if (running_thread == nullptr
+      || (running_thread->getId () != dispatcherTid && !(yielding && dispatchOnly)))
+  {
+    sleepsQuantumUpdate();
+    totalQuantums++;
+  }
+
+  parkBlockedGroups();
+  if (nothingReady ())
+  {
+    if (to_block){
+      running_thread->setState(RUNNING);
+      running_thread->setCarried (0);
+    }
+    startQuantum (running_thread);
+    is_blocked = false;
+    siglongjmp (running_thread->env, ANOTHER_THREAD_JUMP);
+  }
+  if (running_thread != nullptr && !to_block)
+  {
+    running_thread->setState(READY);
+    if (!to_sleep){
+      makeReady (running_thread);
+    }
+  }
+  if (running_thread != nullptr)
+  {
+    // Only the timer passes a context; the other switch-outs without a block
+    // come from a yield or from blocking the running thread's group.
+    TraceReason reason = to_block ? TRACE_BLOCK
+                         : switchRequest.context != nullptr ? TRACE_PREEMPT
+                         : running_thread->getGroup () != NO_GROUP
+                           && groups[running_thread->getGroup ()].blocked ? TRACE_GROUP_BLOCK
+                         : TRACE_YIELD;
+    uthread_scheduler::trace (TRACE_SWITCH_OUT, running_thread->getId (), reason);
+  }
+
+  // The fronts were cleared by parkBlockedGroups, and requeueing the running
+  // thread can't put a member of a blocked group in front.
+  bool handing_off = handoff != NO_THREAD && handoffReady (handoff);
+  Thread *nextThread;
+  if (handing_off)
+  {
+    nextThread = threadsVector[handoff].get ();
+    removeFromReady (threadsVector[handoff]);
+  }
+  else
+  {
+    nextThread = popNext ();
+  }
+  nextThread->setState (RUNNING);
+  running_thread = threadsVector[nextThread->getId ()];
+  uthread_scheduler::trace (TRACE_SWITCH_IN, running_thread->getId ());
+  startQuantum (running_thread);
+  if (adaptive.on && totalQuantums % ADAPTIVE_PERIOD == 0)
+  {
+    tuneQuantum ();
+  }
+  // A directed yield leaves the timer running, so the target gets the rest of
+  // the yielding thread's quantum; re-arming it with the time left would round
+  // that up to a whole timer tick on every handoff.
+  if (!handing_off)
+  {
+    armTimer (running_thread);
+  }
+  if (running_thread->isShared () && sharedOwner != running_thread.get ())
+  {
+    giveSharedStack ();
+  }
+  // Every saved context has the timer blocked, so no tick can land inside
+  // siglongjmp; the target re-enables it once it is back on its own stack.
+  is_blocked = false;
+  siglongjmp (running_thread->env, ANOTHER_THREAD_JUMP);
+}
+
+/**
+ * Switches execution from the current running thread to the next thread in the ready queue.
+ * The scheduling runs on the scheduler stack, so the thread's own stack, which under the timer signal already holds
+ * the signal frame, only holds this call. The caller saves the running thread's context first, unless it terminated.
+ *
+ * @param to_block A boolean indicating whether the current thread should be blocked.
+ * @param to_sleep A boolean indicating whether the current thread should be put to sleep.
+ * @param handoff The thread to switch to directly, with the rest of the running quantum, if it is READY.
+ * @param context The interrupted context when called from the timer signal handler, sampled by the profiler.
+ */
+__attribute__ ((noreturn)) void jumpToThread (bool to_block, bool to_sleep,
+                                              int handoff = NO_THREAD,
+                                              void *context = nullptr)
+{
+  if (sharedOwner != nullptr)
+  {
+    markSharedSp ();
+  }
+  switchRequest = {to_block, to_sleep, handoff, context};
+  siglongjmp (schedulerEnv, ANOTHER_THREAD_JUMP);
+}
+
+/**
+ * Signal handler function for the virtual timer.
+ * This function switches execution from the current running thread to the next thread in the ready queue.
+ *
+ * @param sig The signal number.
+ * @param info Information about the signal (unused).
+ * @param context The interrupted context of the running thread, sampled by the profiler.
+ */
+void timer_handler (int sig, siginfo_t * /* info */, void *context)
+{
+  // The timer signal is process-wide, so it may land on an OS thread that only
+  // posts work; hand it over to the thread that runs the library.
+  if (!pthread_equal (pthread_self (), schedulerThread))
+  {
+    pthread_kill (schedulerThread, sig);
+    return;
+  }
+  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
+  if (ret_val == 0)
+  {
+    jumpToThread(false, false, NO_THREAD, context);
+  }
+  switchDone ();
+}
+
+/**
+timerInitialize - initializes the timer that determines the time quantum for each thread
+@param usecs: the time in microseconds for each quantum
+@return void
+*/
+void timerInitialize (int quantum_usecs)
+{
+  // Install timer_handler as the signal handler for SIGVTALRM.
+  sa.sa_sigaction = &timer_handler;
+  sa.sa_flags = SA_SIGINFO;
+  if (sigaction (SIGVTALRM, &sa, NULL) < 0)
+  {
+    err_sys_print (SIGACTION_ERR);
+  }
+  if (sigaddset (&blockedSigSet, SIGVTALRM) < 0)
+  {
+    err_sys_print (SIGADDSET_ERR);
+  }
+
+  quantumUsecs = quantum_usecs;
+  baseQuantumUsecs = quantum_usecs;
+  timer.it_value.tv_sec = quantum_usecs/MIL;
+  timer.it_value.tv_usec = quantum_usecs%MIL;
+
+  timer.it_interval.tv_sec = quantum_usecs/MIL;
+  timer.it_interval.tv_usec = quantum_usecs%MIL;
+
+  if (setitimer (ITIMER_VIRTUAL, &timer, NULL) < 0)
+  {
+    err_sys_print (SETTIMER_ERR);
+  }
+
+}
+
+/**
+findSource - finds a wake source of a waiting thread
+@param wait: the wait to search
+@param type: the type of the source
+@param arg: the thread ID of an exit source, ignored otherwise
+@return the index of the first matching source, or NO_SOURCE
+*/
+int findSource (const WaitState &wait, int type, int arg)
+{
+  for (int i = 0; i < wait.count; i++)
+  {
+    if (wait.sources[i].type == type
+        && (type != UTHREAD_WAKE_EXIT || wait.sources[i].arg == arg))
+    { return i; }
+  }
+  return NO_SOURCE;
+}
+
+/**
+cancelWait - ends the wait of a thread without waking it
+@param tid: the ID of the thread
+@return void
+*/
+void cancelWait (int tid)
+{
+  WaitState &wait = waits[tid];
+  if (wait.sources == nullptr)
+  { return; }
+  pollSources -= wait.polls;
+  wait.sources = nullptr;
+}
+
+/**
+fireWait - wakes a waiting thread, moving it to the end of the ready queue
+@param tid: the ID of the thread
+@param index: the index of the source that woke it
+@return void
+*/
+void fireWait (int tid, int index)
+{
+  cancelWait (tid);
+  waits[tid].fired = index;
+  removefromSleeps (tid);
+  std::shared_ptr<Thread> &thread = threadsVector[tid];
+  uthread_scheduler::trace (TRACE_RESUME, tid);
+  thread->setState (READY);
+  makeReady (thread);
+}
+
+/**
+wakeExitWaiters - wakes the threads waiting for a thread to terminate
+@param tid: the ID of the terminated thread
+@return void
+*/
+void wakeExitWaiters (int tid)
+{
+  for (int waiter = 0; waiter < uthread_scheduler::table_size; waiter++)
+  {
+    if (waits[waiter].sources == nullptr)
+    { continue; }
+    int index = findSource (waits[waiter], UTHREAD_WAKE_EXIT, tid);
+    if (index != NO_SOURCE)
+    {
+      fireWait (waiter, index);
+    }
+  }
+}
+
+/**
+pollWaiters - polls the file descriptors of the waiting threads and wakes the
+ threads whose file descriptor is ready
+@param wake_fd: an extra descriptor polled for POLLIN, or -1
+@param timeout_msecs: the poll timeout, negative to wait forever
+@return whether wake_fd is readable
+*/
+bool pollWaiters (int wake_fd, int timeout_msecs)
+{
+  // The first entry is wake_fd; poll ignores it when it is -1.
+  std::vector<struct pollfd> &fds = pollFds;
+  std::vector<std::pair<int, int>> &owners = pollOwners;
+  fds.assign (1, {wake_fd, POLLIN, 0});
+  owners.assign (1, {NO_THREAD, NO_SOURCE});
+  for (int tid = 0; pollSources > 0 && tid < uthread_scheduler::table_size; tid++)
+  {
+    const WaitState &wait = waits[tid];
+    for (int i = 0; wait.sources != nullptr && wait.polls > 0 && i < wait.count; i++)
+    {
+      if (wait.sources[i].type == UTHREAD_WAKE_FD)
+      {
+        fds.push_back ({wait.sources[i].arg, wait.sources[i].events, 0});
+        owners.push_back ({tid, i});
+      }
+    }
+  }
+  if (poll (fds.data (), fds.size (), timeout_msecs) < 0)
+  {
+    if (errno != EINTR)
+    {
+      err_sys_print (IDLE_POLL_ERR);
+    }
+    return false;
+  }
+  for (size_t i = 1; i < fds.size (); i++)
+  {
+    int tid = owners[i].first;
+    if (fds[i].revents != 0 && waits[tid].sources != nullptr)
+    {
+      fireWait (tid, owners[i].second);
+    }
+  }
+  return fds[0].revents != 0;
+}
+
+/**
+sleepsQuantumUpdate - updates the sleep time of each thread in the sleep queue
+ and wakes up the threads that finish their times
+@return void
+*/
+void sleepsQuantumUpdate()
+{
+  for (int tid = 0; sleepers > 0 && tid < uthread_scheduler::table_size; tid++)
+  {
+    if (!sleeping[tid])
+    { continue; }
+    if (sleepQuantums[tid] == 0)
+    {
+      removefromSleeps (tid);
+      std::shared_ptr<Thread> &weakup_thread = threadsVector[tid];
+      uthread_scheduler::trace (TRACE_WAKE, tid);
+      if (waits[tid].sources != nullptr)
+      {
+        fireWait (tid, waits[tid].timer);
+      }
+      else if(weakup_thread->getState() != BLOCKED){
+        weakup_thread->setState(READY);
+        makeReady (weakup_thread);
+      }
+    }
+    else
+    {
+      sleepQuantums[tid]--;
+    }
+  }
+}
+
+/**
+resumeThread - moves a BLOCKED thread back to READY, and to the end of the
+ ready queue unless it is still sleeping
+@param thread: the thread to resume
+@param run_next: whether it goes to the run-next slot instead of the ready queue
+@return void
+*/
+void resumeThread (const std::shared_ptr<Thread> &thread, bool run_next)
+{
+  if (thread->getState () == BLOCKED)
+  {
+    const WaitState &wait = waits[thread->getId ()];
+    if (wait.sources != nullptr)
+    {
+      // A waiting thread is only woken by a resume if it waits for one.
+      int index = findSource (wait, UTHREAD_WAKE_RESUME, 0);
+      if (index != NO_SOURCE)
+      {
+        fireWait (thread->getId (), index);
+      }
+      return;
+    }
+    uthread_scheduler::trace (TRACE_RESUME, thread->getId ());
+    if (!sleeping[thread->getId ()]) {
+      makeReady (thread, run_next);
+    }
+    thread->setState (READY);
+  }
+}
+
+/**
+blockRunning - blocks the running thread until it is resumed. Unlike
+ uthread_block, it isn't interrupted by cancellation, so waits that must finish,
+ like joins, use it. Called with the timer signal blocked; returns with it enabled.
+@return void
+*/
+void blockRunning ()
+{
+  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
+  if (ret_val == 0)
+  {
+    jumpToThread(true, false);
+  }
+  signalsRestoreAfterJump();
+}
+
+/**
+resumeBlocked - resumes a thread like uthread_resume, for callers that are
+ inside a blocked region. Called with the timer signal blocked, which stays blocked.
+@param tid: the ID of the thread
+@return void
+*/
+void resumeBlocked (int tid)
+{
+  if (uthread_scheduler::validTid (tid) && threadsVector[tid] != nullptr)
+  {
+    resumeThread (threadsVector[tid], runNextOn);
+  }
+}
+
+/**
+cancelCheck - fails a blocking operation of a cancelled thread
+@param tid: the ID of the thread
+@return FAILURE with errno set to ECANCELED if the thread was cancelled, SUCCESS otherwise
+*/
+int cancelCheck (int tid)
+{
+  if (!cancelled[tid])
+  { return SUCCESS; }
+  errno = ECANCELED;
+  return FAILURE;
+}
+
+/**
+cancelThread - marks a thread as cancelled and interrupts the sleep, block or
+ wait it is in, moving it to the end of the ready queue. The interrupted
+ operation returns ECANCELED once the thread runs.
+@param tid: the ID of the thread
+@return void
+*/
+void cancelThread (int tid)
+{
+  cancelled[tid] = true;
+  std::shared_ptr<Thread> &thread = threadsVector[tid];
+  if (thread->isEqual (running_thread)
+      || (thread->getState () != BLOCKED && !sleeping[tid]))
+  { return; }
+  removefromSleeps (tid);
+  cancelWait (tid);
+  dropRelease (tid);
+  uthread_scheduler::trace (TRACE_RESUME, tid);
+  thread->setState (READY);
+  makeReady (thread);
+}
+
+/**
+postDispatcher - the entry point of the dispatcher thread. Drains the requests
+ injected by other OS threads, fires the expired timers and runs the posted
+ functions in order, and blocks until wakeDispatcher resumes it otherwise.
+@return void
+*/
+void postDispatcher ()
+{
+  for (;;)
+  {
+    block_signals_helper();
+    drainInjected ();
+    fireTimers ();
+    if (postedCalls.empty ())
+    {
+      // A request pushed from here on is seen by the next scheduling point,
+      // which resumes the dispatcher once it is blocked.
+      blockRunning ();
+      continue;
+    }
+    PostedCall call = postedCalls.front ();
+    postedCalls.pop_front ();
+    unblock_signals_helper();
+    call.fn (call.arg);
+  }
+}
+
+/**
+completeOffload - resumes the thread parked on a finished blocking call, or frees
+ the call if its thread was terminated meanwhile
+@param job: the finished call
+@return void
+*/
+void completeOffload (OffloadJob *job)
+{
+  if (offloadWaits[job->tid] != job)
+  {
+    delete job;
+    return;
+  }
+  offloadWaits[job->tid] = nullptr;
+  resumeThread (threadsVector[job->tid]);
+}
+
+/**
+wakeDispatcher - resumes the dispatcher thread if it is blocked, so the work it
+ is woken for is done at the next scheduling decision that no EDF thread takes.
+ It doesn't go through the run-next slot, which stays the user's. Doesn't
+ allocate, so scheduling points may call it.
+@return void
+*/
+void wakeDispatcher ()
+{
+  const std::shared_ptr<Thread> &dispatcher = threadsVector[dispatcherTid];
+  if (dispatcher->getState () == BLOCKED)
+  {
+    uthread_scheduler::trace (TRACE_RESUME, dispatcherTid);
+    dispatcher->setState (READY);
+    dispatcherWoken = true;
+  }
+}
+
+/**
+drainInjected - applies the requests injected by other OS threads: resumes the
+ requested threads and the threads whose blocking calls finished, and hands posted
+ functions to the dispatcher thread. Frees the queue's nodes, so it is only
+ called from threads, with the timer signal blocked.
+@return void
+*/
+void drainInjected ()
+{
+  InjectedRequest request;
+  while (injectQueue.pop (request))
+  {
+    if (request.done != nullptr)
+    {
+      completeOffload (request.done);
+    }
+    else if (request.fn != nullptr)
+    {
+      postedCalls.push_back ({request.fn, request.arg});
+    }
+    else if (threadsVector[request.tid] != nullptr)
+    {
+      resumeThread (threadsVector[request.tid]);
+    }
+  }
+  if (!postedCalls.empty ())
+  {
+    wakeDispatcher ();
+  }
+}
+
+/**
+timerDue - checks if the earliest timer expired. Doesn't allocate, so
+ scheduling points may call it.
+@return true if a timer is due, false otherwise
+*/
+bool timerDue ()
+{
+  return !timerQueue.empty () && timerQueue.topKey () <= monotonicNow ();
+}
+
+/**
+fireTimers - queues the callbacks of the expired timers as posted calls,
+ re-arming the periodic timers and freeing the one-shot ones. Allocates, so it
+ is only called from the dispatcher thread, with the timer signal blocked.
+@return void
+*/
+void fireTimers ()
+{
+  if (timerQueue.empty ())
+  { return; }
+  long now = monotonicNow ();
+  while (!timerQueue.empty () && timerQueue.topKey () <= now)
+  {
+    int id = timerQueue.top ();
+    timerQueue.pop ();
+    TimerState &entry = timers[id];
+    postedCalls.push_back ({entry.callback, entry.arg});
+    if (entry.periodic)
+    {
+      // Periods missed while the process didn't reach a scheduling point are skipped.
+      do
+      {
+        entry.deadline_ns += entry.interval_ns;
+      }
+      while (entry.deadline_ns <= now);
+      timerQueue.push (id, entry.deadline_ns);
+    }
+    else
+    {
+      entry.used = false;
+      freeTimers.push_back (id);
+    }
+  }
+}
+
+/**
+injectRequest - pushes a request to the injection queue and wakes up the
+ scheduler if it waits in uthread_idle_wait. Safe to call from any OS thread.
+ The push allocates its node, so on the scheduler's OS thread, where the timer
+ signal lands, it is done with the signal blocked, leaving the caller's mask as
+ it was.
+@param request: the request to push
+@return void
+*/
+void injectRequest (const InjectedRequest &request)
+{
+  bool onScheduler = pthread_equal (pthread_self (), schedulerThread);
+  bool wasBlocked = onScheduler && signalsBlocked ();
+  if (onScheduler)
+  {
+    block_signals_helper();
+  }
+  injectQueue.push (request);
+  if (onScheduler && !wasBlocked)
+  {
+    unblock_signals_helper();
+  }
+  if (schedulerIdle.load () && injectEventFd != -1)
+  {
+    uint64_t one = 1;
+    if (write (injectEventFd, &one, sizeof (one)) < 0)
+    {
+      // EAGAIN: the counter is saturated, so a wakeup is pending anyway.
+    }
+  }
+}
+
+/**
+offloadWorker - the loop of an offload pool worker: runs blocking calls and
+ reports each completion through the injection queue
+@param unused: the pthread argument, unused
+@return never returns
+*/
+void *offloadWorker (void *)
+{
+  for (;;)
+  {
+    pthread_mutex_lock (&offloadMutex);
+    while (offloadJobs.empty ())
+    {
+      pthread_cond_wait (&offloadCond, &offloadMutex);
+    }
+    OffloadJob *job = offloadJobs.front ();
+    offloadJobs.pop_front ();
+    pthread_mutex_unlock (&offloadMutex);
+    job->result = job->fn (job->arg);
+    job->err = errno;
+    injectRequest ({nullptr, nullptr, job->tid, job});
+  }
+  return nullptr;
+}
+
+/**
+startOffloadWorkers - starts pool workers until offloadSize of them run. Called
+ with the timer signal blocked, which the workers inherit, so the timer is only
+ ever delivered to the scheduler thread.
+@return void
+*/
+void startOffloadWorkers ()
+{
+  while (offloadWorkers < offloadSize)
+  {
+    pthread_t worker;
+    if (pthread_create (&worker, nullptr, offloadWorker, nullptr) != 0)
+    {
+      err_sys_print (PTHREAD_CREATE_ERR);
+    }
+    pthread_detach (worker);
+    offloadWorkers++;
+  }
+}
+
+/**
+startSleep - puts a thread to sleep for a number of quantums
+@param tid: the ID of the thread
+@param num_quantums: the number of quantums
+@return void
+*/
+void startSleep (int tid, int num_quantums)
+{
+  if (!sleeping[tid])
+  {
+    sleeping[tid] = true;
+    sleepers++;
+  }
+  sleepQuantums[tid] = num_quantums;
+}
+
+/**
+Removes a thread from the sleeping threads, if it sleeps.
+@param tid Thread ID to remove from the sleeping threads
+*/
+void removefromSleeps(int tid){
+  if (sleeping[tid])
+  {
+    sleeping[tid] = false;
+    sleepers--;
+  }
+}
+
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+int uthread_init (int quantum_usecs)
+{
+  if (quantum_usecs <= 0)
+  {
+    err_lib_print (INIT_ERR);
+    return FAILURE;
+  }
+  schedulerThread = pthread_self ();
+  injectEventFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (injectEventFd < 0)
+  {
+    err_sys_print (EVENTFD_ERR);
+  }
+  try
+  {
+    schedulerStack = new char[SCHEDULER_STACK_SIZE];
+  }
+  catch (std::bad_alloc &e)
+  {
+    err_sys_print (BAD_ALLOC_ERR);
+  }
+  initContext (schedulerEnv, schedulerStack, SCHEDULER_STACK_SIZE, schedule);
+  // Only entered with the timer blocked, which it leaves blocked, so the jump
+  // doesn't need to restore a signal mask.
+  schedulerEnv->__mask_was_saved = 0;
+  timerInitialize (quantum_usecs);
+  uthread_create (nullptr, uthread_scheduler::stack_size, NO_GROUP);
+  // Created here rather than on first use, since other OS threads may post
+  // before any library call; it waits BLOCKED until there is work for it.
+  uthread_create (postDispatcher, DISPATCHER_STACK_SIZE, NO_GROUP, dispatcherTid);
+  removeFromReady (threadsVector[dispatcherTid]);
+  threadsVector[dispatcherTid]->setState (BLOCKED);
+  totalQuantums = 1;
+  sliceStartCpu = uthread_scheduler::stats ? cpuNow () : 0;
+  return SUCCESS;
+
+}
+
+int uthread_spawn (thread_entry_point entry_point)
+{
+  return uthread_spawn_with_stack (entry_point, uthread_scheduler::stack_size);
+}
+
+int uthread_spawn_with_stack (thread_entry_point entry_point, int stack_size)
+{
+  if (stack_size < uthread_scheduler::stack_size || stack_size % STACK_ALIGN != 0)
+  {
+    err_lib_print (STACK_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  int id = spawnThread (entry_point, stack_size, NO_GROUP);
+  unblock_signals_helper();
+  return id;
+}
+
+int uthread_spawn_shared (thread_entry_point entry_point)
+{
+  block_signals_helper();
+  int id = spawnThread (entry_point, SHARED_STACK, NO_GROUP);
+  unblock_signals_helper();
+  return id;
+}
+
+int uthread_terminate (int tid)
+{
+  block_signals_helper();
+  if (tid == 0)
+  {
+    unblock_signals_helper();
+    Clear_database();
+    exit (0);
+  }
+  if (tidCheck (tid, TERMINATE_ERR, 0) == FAILURE)
+  { unblock_signals_helper();
+    return FAILURE; }
+  std::shared_ptr<Thread> thread = threadsVector[tid];
+  leaveGroup (thread);
+  cancelWait (tid);
+
+  if (thread->isEqual (running_thread))
+  {
+    chargeCpu (running_thread);
+    endJob (tid);
+    clearDeadline (tid);
+    dropQuota (tid);
+    forgetSharedStack (thread.get ());
+    uthread_scheduler::trace (TRACE_SWITCH_OUT, tid, TRACE_TERMINATE);
+    threadsVector[tid] = nullptr;
+    scheduler.releaseId (tid);
+    wakeExitWaiters (tid);
+    // This frame never returns, so the thread is handed to schedule to free.
+    exitedThread = std::move (thread);
+    // No timer tick may land mid-switch; the target's mask is restored by the jump.
+    running_thread = nullptr;
+    jumpToThread(false, false);
+  }
+  releaseThread (tid);
+  freeThread (thread);
+
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_block (int tid)
+{
+  if (tidCheck (tid, BLOCK_ERR, 1) == FAILURE)
+  { return FAILURE; }
+  if (threadsVector[tid]->getState() == BLOCKED){return SUCCESS; }
+  block_signals_helper();
+
+  std::shared_ptr<Thread> &thread = threadsVector[tid];
+
+  if (thread->isEqual (running_thread))
+  {
+    if (cancelCheck (tid) == FAILURE)
+    {
+      unblock_signals_helper();
+      return FAILURE;
+    }
+    // The timer stays blocked until the switch, so a resume can't slip in
+    // between the caller's last check and the thread actually blocking.
+    blockRunning ();
+    return cancelCheck (tid);
+  }
+  else
+  {
+    // Only the running thread switches out; a READY thread just leaves the queue.
+    thread->setState(BLOCKED);
+    removeFromReady(thread);
+    unblock_signals_helper();
+  }
+
+  return SUCCESS;
+}
+
+int uthread_resume (int tid)
+{
+  if (tidCheck (tid, RESUME_ERR, 0) == FAILURE)
+  {
+    return FAILURE; }
+  block_signals_helper();
+  resumeThread (threadsVector[tid], runNextOn);
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+void uthread_set_run_next (int enable)
+{
+  block_signals_helper();
+  runNextOn = enable != 0;
+  if (!runNextOn && runNext != nullptr)
+  {
+    readyQueue.pushBack (runNext);
+    runNext = nullptr;
+  }
+  unblock_signals_helper();
+}
+
+/**
+yieldTo - moves the running thread to the end of the READY queue and makes a
+ scheduling decision, unless no other thread is READY. Called with the timer
+ signal blocked; returns with it enabled.
+@param handoff: the thread to switch to directly if it is READY, or NO_THREAD
+@return void
+*/
+void yieldTo (int handoff)
+{
+  refillDue ();
+  parkBlockedGroups ();
+  if (nothingReady ())
+  {
+    // The quantum goes on, so yielding in a loop doesn't speed up the sleepers.
+    unblock_signals_helper();
+    return;
+  }
+  chargeCpu (running_thread);
+  busyNs[running_thread->getId ()] = 0;
+  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
+  if (ret_val == 0)
+  {
+    jumpToThread(false, false, handoff);
+  }
+  signalsRestoreAfterJump();
+}
+
+int uthread_yield ()
+{
+  block_signals_helper();
+  yieldTo (NO_THREAD);
+  return SUCCESS;
+}
+
+int uthread_yield_to (int tid)
+{
+  block_signals_helper();
+  if (tidCheck (tid, YIELD_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  yieldTo (tid);
+  return SUCCESS;
+}
+
+int uthread_sleep (int num_quantums)
+{
+
+  if (running_thread->getId() ==0){
+    err_lib_print (SLEEP_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  int tid = running_thread->getId ();
+  if (cancelCheck (tid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  startSleep (tid, num_quantums);
+  uthread_scheduler::trace (TRACE_SWITCH_OUT, running_thread->getId(), TRACE_SLEEP);
+  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
+  if (ret_val == 0)
+  {
+    chargeCpu (running_thread);
+    busyNs[tid] = 0;
+    saveUnusedSlice (running_thread);
+    endJob (running_thread->getId ());
+    running_thread = nullptr;
+    jumpToThread(false, true);
+  }
+  signalsRestoreAfterJump();
+  return cancelCheck (tid);
+}
+
+int uthread_get_total_quantums()
+{
+  return totalQuantums;
+}
+
+int uthread_get_quantums(int tid){
+  block_signals_helper();
+  if (tidCheck (tid, QUANTUM_ERR , 0) == FAILURE)
+    { return FAILURE; }
+  unblock_signals_helper();
+  return threadsVector[tid]->getQuantums();
+}
+
+/**
+snapshotState - the state of a thread as reported by uthread_snapshot
+@param tid: the ID of the thread
+@return a UTHREAD_STATE_* value
+*/
+int snapshotState (int tid)
+{
+  if (threadsVector[tid]->isEqual (running_thread))
+  { return UTHREAD_STATE_RUNNING; }
+  if (sleeping[tid] && threadsVector[tid]->getState () != BLOCKED)
+  { return UTHREAD_STATE_SLEEPING; }
+  const std::shared_ptr<Thread> &thread = threadsVector[tid];
+  int gid = thread->getGroup ();
+  if (thread->getState () == READY && (gid == NO_GROUP || !groups[gid].blocked)
+      && (selfThrottled (tid) || (gid != NO_GROUP && groups[gid].quota.throttled)))
+  { return UTHREAD_STATE_THROTTLED; }
+  return handoffReady (tid) ? UTHREAD_STATE_READY : UTHREAD_STATE_BLOCKED;
+}
+
+int uthread_snapshot (uthread_info *buf, int n)
+{
+  if (n < 0 || (buf == nullptr && n > 0))
+  {
+    err_lib_print (SNAPSHOT_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  long now = uthread_scheduler::stats ? monotonicNow () : 0;
+  long cpu = uthread_scheduler::stats ? cpuNow () : 0;
+  int count = 0;
+  for (int tid = 0; tid < uthread_scheduler::max_threads && count < n; tid++)
+  {
+    const std::shared_ptr<Thread> &thread = threadsVector[tid];
+    if (thread == nullptr)
+    { continue; }
+    uthread_info &info = buf[count++];
+    info.tid = tid;
+    info.state = snapshotState (tid);
+    info.quantums = thread->getQuantums ();
+    info.sleep_quantums = sleeping[tid] ? sleepQuantums[tid] : 0;
+    info.idle_usecs = 0;
+    info.busy_usecs = busyNs[tid] / NSEC_PER_USEC;
+    if (info.state == UTHREAD_STATE_RUNNING)
+    {
+      info.busy_usecs += (cpu - sliceStartCpu) / NSEC_PER_USEC;
+    }
+    else if (uthread_scheduler::stats)
+    {
+      info.idle_usecs = (now - lastRunNs[tid]) / NSEC_PER_USEC;
+    }
+  }
+  unblock_signals_helper();
+  return count;
+}
+
+int uthread_set_timeslice (int tid, int usecs)
+{
+  block_signals_helper();
+  if (tidCheck (tid, TIMESLICE_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  if (usecs < 0)
+  {
+    unblock_signals_helper();
+    err_lib_print (TIMESLICE_ERR);
+    return FAILURE;
+  }
+  std::shared_ptr<Thread> &thread = threadsVector[tid];
+  thread->setTimeslice (usecs);
+  if (thread->isEqual (running_thread))
+  {
+    // The running quantum keeps its length; the reload after it uses the new slice.
+    struct itimerval current;
+    if (getitimer (ITIMER_VIRTUAL, &current) < 0)
+    {
+      err_sys_print (SETTIMER_ERR);
+    }
+    int slice = threadSlice (thread);
+    timer.it_value = current.it_value;
+    timer.it_interval.tv_sec = slice / MIL;
+    timer.it_interval.tv_usec = slice % MIL;
+    if (setitimer (ITIMER_VIRTUAL, &timer, NULL) < 0)
+    {
+      err_sys_print (SETTIMER_ERR);
+    }
+  }
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_set_adaptive_quantum (int min_usecs, int max_usecs,
+                                  int overhead_permille, int max_delay_usecs)
+{
+  if (max_usecs == 0)
+  {
+    block_signals_helper();
+    adaptive.on = false;
+    quantumUsecs = baseQuantumUsecs;
+    unblock_signals_helper();
+    return SUCCESS;
+  }
+  if (min_usecs <= 0 || max_usecs < min_usecs || overhead_permille <= 0
+      || overhead_permille > PERMILLE || max_delay_usecs < 0)
+  {
+    err_lib_print (ADAPTIVE_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  adaptive = {true, min_usecs, max_usecs, overhead_permille, max_delay_usecs};
+  tuneQuantum ();
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_get_quantum_usecs ()
+{
+  return quantumUsecs;
+}
+
+int uthread_get_timeslice (int tid)
+{
+  block_signals_helper();
+  if (tidCheck (tid, TIMESLICE_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  int slice = threadSlice (threadsVector[tid]);
+  unblock_signals_helper();
+  return slice;
+}
+
+int uthread_set_carry_over (int tid, int enable)
+{
+  block_signals_helper();
+  if (tidCheck (tid, CARRY_OVER_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  threadsVector[tid]->setCarryOver (enable != 0);
+  if (enable == 0)
+  {
+    threadsVector[tid]->setCarried (0);
+  }
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+/**
+setDeadlineClass - changes the EDF parameters of a thread, moving it between the
+ deadline queue and the ready queue if it is READY. Its next job uses them.
+@param tid: the ID of the thread
+@param relative_usecs: the relative deadline, 0 for round-robin
+@param period_usecs: the period, 0 for a plain deadline
+@param utilization: the CPU share of the reservation
+@param runtime_usecs: the runtime of the reservation, 0 for a plain deadline
+@return void
+*/
+void setDeadlineClass (int tid, int relative_usecs, int period_usecs,
+                       double utilization, int runtime_usecs)
+{
+  std::shared_ptr<Thread> &thread = threadsVector[tid];
+  DeadlineState &edf = deadlines[tid];
+  bool queued = ThreadQueue::isQueued (thread.get ()) || runNext == thread.get ()
+                || deadlineQueue.contains (tid);
+  if (queued)
+  {
+    removeFromReady (thread);
+  }
+  reservedUtilization += utilization - edf.utilization;
+  edf.relative_usecs = relative_usecs;
+  edf.period_usecs = period_usecs;
+  edf.utilization = utilization;
+  edf.deadline_ns = 0;
+  edf.demoted = false;
+  // The thread is out of the queues, so a throttled budget is dropped without requeueing it.
+  setQuota (budgetQuota (tid), runtime_usecs, period_usecs);
+  if (queued)
+  {
+    makeReady (thread);
+  }
+}
+
+int uthread_set_deadline (int tid, int relative_usecs)
+{
+  block_signals_helper();
+  if (tidCheck (tid, DEADLINE_ERR, 1) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  if (relative_usecs < 0)
+  {
+    unblock_signals_helper();
+    err_lib_print (DEADLINE_ERR);
+    return FAILURE;
+  }
+  setDeadlineClass (tid, relative_usecs, 0, 0, 0);
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_set_reservation (int tid, int runtime_usecs, int period_usecs,
+                             int deadline_usecs)
+{
+  block_signals_helper();
+  if (tidCheck (tid, RESERVATION_ERR, 1) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  if (deadline_usecs == 0)
+  {
+    deadline_usecs = period_usecs;
+  }
+  if (runtime_usecs <= 0 || runtime_usecs > deadline_usecs
+      || deadline_usecs > period_usecs)
+  {
+    unblock_signals_helper();
+    err_lib_print (RESERVATION_ERR);
+    return FAILURE;
+  }
+  // Density test: with constrained deadlines, EDF meets every deadline while
+  // the sum of runtime / deadline stays within the bound.
+  double utilization = (double) runtime_usecs / deadline_usecs;
+  if (reservedUtilization - deadlines[tid].utilization + utilization
+      > EDF_MAX_UTILIZATION / 100.0)
+  {
+    unblock_signals_helper();
+    err_lib_print (ADMISSION_ERR);
+    return FAILURE;
+  }
+  setDeadlineClass (tid, deadline_usecs, period_usecs, utilization, runtime_usecs);
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_wait_next_period ()
+{
+  block_signals_helper();
+  int tid = running_thread->getId ();
+  DeadlineState &edf = deadlines[tid];
+  if (edf.period_usecs == 0)
+  {
+    unblock_signals_helper();
+    err_lib_print (PERIOD_ERR);
+    return FAILURE;
+  }
+  if (cancelCheck (tid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  long next = edf.release_ns + (long) edf.period_usecs * NSEC_PER_USEC;
+  endJob (tid);
+  if (next <= monotonicNow ())
+  {
+    // The job overran into the next period, which is released right away.
+    startJob (edf, next);
+    refillBudget (tid, next);
+    unblock_signals_helper();
+    return SUCCESS;
+  }
+  edf.next_release_ns = next;
+  releases.push (tid, next);
+  while (edf.next_release_ns != 0 && !cancelled[tid])
+  {
+    blockRunning ();
+    block_signals_helper();
+  }
+  // A cancelled thread stops waiting for its next period.
+  dropRelease (tid);
+  unblock_signals_helper();
+  return cancelCheck (tid);
+}
+
+int uthread_get_deadline_misses (int tid)
+{
+  block_signals_helper();
+  if (tidCheck (tid, DEADLINE_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  int misses = deadlines[tid].misses;
+  unblock_signals_helper();
+  return misses;
+}
+
+/**
+quotaCheck - checks the parameters of a quota
+@param runtime_usecs: the CPU time allowed per period, 0 to remove the quota
+@param period_usecs: the length of a period
+@return SUCCESS if the quota can be set, FAILURE otherwise
+*/
+int quotaCheck (int runtime_usecs, int period_usecs)
+{
+  if (!uthread_scheduler::stats)
+  {
+    err_lib_print (QUOTA_STATS_ERR);
+    return FAILURE;
+  }
+  if (runtime_usecs < 0
+      || (runtime_usecs > 0 && (period_usecs <= 0 || runtime_usecs > period_usecs)))
+  {
+    err_lib_print (QUOTA_ERR);
+    return FAILURE;
+  }
+  return SUCCESS;
+}
+
+/**
+setQuota - replaces a quota, its first period starting now
+@param owner: the key of the quota in refills
+@param runtime_usecs: the CPU time allowed per period, 0 to remove the quota
+@param period_usecs: the length of a period
+@return void
+*/
+void setQuota (int owner, int runtime_usecs, int period_usecs)
+{
+  QuotaState &quota = quotaOf (owner);
+  bool throttled = quota.throttled;
+  dropQuota (owner);
+  quota.runtime_ns = (long) runtime_usecs * NSEC_PER_USEC;
+  quota.period_ns = (long) period_usecs * NSEC_PER_USEC;
+  quota.used_ns = 0;
+  quota.period_end_ns = monotonicNow () + quota.period_ns;
+  if (throttled)
+  {
+    releaseQuota (owner);
+  }
+}
+
+/**
+throttledUsecs - the time a quota spent throttled, including the current throttle
+@param owner: the key of the quota in refills
+@return the time in microseconds
+*/
+long throttledUsecs (int owner)
+{
+  const QuotaState &quota = quotaOf (owner);
+  long nsecs = quota.throttled_ns;
+  if (quota.throttled)
+  {
+    nsecs += monotonicNow () - quota.throttled_since_ns;
+  }
+  return nsecs / NSEC_PER_USEC;
+}
+
+int uthread_set_quota (int tid, int runtime_usecs, int period_usecs)
+{
+  block_signals_helper();
+  if (tidCheck (tid, QUOTA_ERR, 1) == FAILURE
+      || quotaCheck (runtime_usecs, period_usecs) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  setQuota (tid, runtime_usecs, period_usecs);
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+long uthread_get_throttled_usecs (int tid)
+{
+  block_signals_helper();
+  if (tidCheck (tid, QUOTA_ERR, 0) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  long usecs = throttledUsecs (tid);
+  unblock_signals_helper();
+  return usecs;
+}
+
+int uthread_post (posted_function fn, void *arg)
+{
+  if (fn == nullptr)
+  {
+    err_lib_print (POST_ERR);
+    return FAILURE;
+  }
+  injectRequest ({fn, arg, NO_THREAD, nullptr});
+  return SUCCESS;
+}
+
+int uthread_timer_create (int interval_usecs, posted_function callback, void *arg,
+                          int mode)
+{
+  if (interval_usecs <= 0 || callback == nullptr
+      || (mode != UTHREAD_TIMER_ONESHOT && mode != UTHREAD_TIMER_PERIODIC))
+  {
+    err_lib_print (TIMER_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  int id;
+  if (freeTimers.empty ())
+  {
+    id = (int) timers.size ();
+    timers.push_back (TimerState ());
+    timerQueue.reserve ((int) timers.capacity ());
+  }
+  else
+  {
+    id = freeTimers.back ();
+    freeTimers.pop_back ();
+  }
+  long interval_ns = (long) interval_usecs * NSEC_PER_USEC;
+  timers[id] = {true, callback, arg, interval_ns, mode == UTHREAD_TIMER_PERIODIC,
+                monotonicNow () + interval_ns};
+  timerQueue.push (id, timers[id].deadline_ns);
+  unblock_signals_helper();
+  return id;
+}
+
+int uthread_timer_cancel (int timer_id)
+{
+  block_signals_helper();
+  if (timer_id < 0 || timer_id >= (int) timers.size () || !timers[timer_id].used)
+  {
+    unblock_signals_helper();
+    err_lib_print (TIMER_ERR);
+    return FAILURE;
+  }
+  TimerState &entry = timers[timer_id];
+  timerQueue.erase (timer_id);
+  entry.used = false;
+  freeTimers.push_back (timer_id);
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_resume_async (int tid)
+{
+  if (!uthread_scheduler::validTid (tid))
+  {
+    err_lib_print (RESUME_ASYNC_ERR);
+    return FAILURE;
+  }
+  injectRequest ({nullptr, nullptr, tid, nullptr});
+  return SUCCESS;
+}
+
+int uthread_blocking_pool_size (int workers)
+{
+  if (workers <= 0 || workers > MAX_BLOCKING_WORKERS)
+  {
+    err_lib_print (BLOCKING_POOL_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  if (workers > offloadSize)
+  {
+    offloadSize = workers;
+  }
+  if (offloadWorkers > 0)
+  {
+    startOffloadWorkers ();
+  }
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+long uthread_blocking_call (blocking_function fn, void *arg)
 {
+  if (fn == nullptr)
+  {
+    err_lib_print (BLOCKING_CALL_ERR);
+    return FAILURE;
+  }
   block_signals_helper();
-  if (tid == 0)
+  int tid = running_thread->getId ();
+  if (cancelCheck (tid) == FAILURE)
   {
     unblock_signals_helper();
-    Clear_database();
-    exit (0);
+    return FAILURE;
   }
+  startOffloadWorkers ();
+  OffloadJob *job = new OffloadJob {fn, arg, tid, 0, 0};
+  offloadWaits[tid] = job;
+  pthread_mutex_lock (&offloadMutex);
+  offloadJobs.push_back (job);
+  pthread_cond_signal (&offloadCond);
+  pthread_mutex_unlock (&offloadMutex);
 
-  if (tidCheck (tid, TERMINATE_ERR, 0) == FAILURE)
-  { unblock_signals_helper();
-    return FAILURE; }
-  std::shared_ptr<Thread> thread = threadsVector[tid];
+  // A uthread_resume while the call runs doesn't end the wait; only
+  // completeOffload clears offloadWaits.
+  while (offloadWaits[tid] == job && !cancelled[tid])
+  {
+    if (tid == 0 && nothingReady ())
+    {
+      // The main thread can't block, so it sleeps on the eventfd once no
+      // other thread is READY.
+      unblock_signals_helper();
+      uthread_idle_wait (-1);
+    }
+    else if (tid == 0)
+    {
+      // Otherwise it lets them run between checks, as uthread_group_wait does.
+      yieldTo (NO_THREAD);
+    }
+    else
+    {
+      blockRunning ();
+    }
+    block_signals_helper();
+  }
+  if (offloadWaits[tid] == job)
+  {
+    // Cancelled: the call can't be stopped, so it is abandoned to its worker
+    // and freed by completeOffload when it returns.
+    offloadWaits[tid] = nullptr;
+    unblock_signals_helper();
+    errno = ECANCELED;
+    return FAILURE;
+  }
+  long result = job->result;
+  int err = job->err;
+  delete job;
+  unblock_signals_helper();
+  errno = err;
+  return result;
+}
 
+int uthread_idle_wait (int timeout_msecs)
+{
+  block_signals_helper();
+  releaseDue ();
+  refillDue ();
+  parkBlockedGroups ();
+  bool idle = nothingReady ();
+  bool fired = false;
+  if (idle)
+  {
+    schedulerIdle.store (true);
+    if (injectQueue.empty ())
+    {
+      pollWaiters (injectEventFd, idleTimeout (timeout_msecs));
+    }
+    schedulerIdle.store (false);
+    uint64_t count;
+    if (read (injectEventFd, &count, sizeof (count)) < 0)
+    {
+      // EAGAIN: woken up by the timeout rather than a producer.
+    }
+    releaseDue ();
+    refillDue ();
+    if (timerDue ())
+    {
+      // The dispatcher runs the expired callbacks before the idle loop goes on.
+      wakeDispatcher ();
+      yieldTo (NO_THREAD);
+      block_signals_helper();
+      fired = true;
+    }
+    parkBlockedGroups ();
+  }
+  bool drained = fired || !injectQueue.empty () || (idle && !nothingReady ());
+  drainInjected ();
+  unblock_signals_helper();
+  return drained ? 1 : 0;
+}
 
-  threadsVector[tid] = nullptr;
-  minValidId.push (tid);
-  if (thread->isEqual (running_thread))
+/**
+immediateSource - finds a wake source that is already satisfied: a thread that
+ doesn't exist, or a ready file descriptor
+@param sources: the wake sources
+@param count: the number of sources
+@return the index of the first satisfied source, or NO_SOURCE
+*/
+int immediateSource (const wake_source *sources, int count)
+{
+  std::vector<struct pollfd> fds;
+  std::vector<int> indices;
+  for (int i = 0; i < count; i++)
+  {
+    if (sources[i].type == UTHREAD_WAKE_EXIT && threadsVector[sources[i].arg] == nullptr)
+    { return i; }
+    if (sources[i].type == UTHREAD_WAKE_FD)
+    {
+      fds.push_back ({sources[i].arg, sources[i].events, 0});
+      indices.push_back (i);
+    }
+  }
+  if (!fds.empty () && poll (fds.data (), fds.size (), 0) > 0)
+  {
+    for (size_t i = 0; i < fds.size (); i++)
+    {
+      if (fds[i].revents != 0)
+      { return indices[i]; }
+    }
+  }
+  return NO_SOURCE;
+}
+
+/**
+sourcesCheck - checks that wake sources are valid for the running thread
+@param sources: the wake sources
+@param count: the number of sources
+@return SUCCESS if the sources are valid, FAILURE otherwise
+*/
+int sourcesCheck (const wake_source *sources, int count)
+{
+  if (sources == nullptr || count <= 0)
+  { return FAILURE; }
+  for (int i = 0; i < count; i++)
+  {
+    const wake_source &source = sources[i];
+    switch (source.type)
+    {
+      case UTHREAD_WAKE_RESUME:
+        break;
+      case UTHREAD_WAKE_TIMER:
+        if (source.arg < 0)
+        { return FAILURE; }
+        break;
+      case UTHREAD_WAKE_FD:
+        if (source.arg < 0 || source.events == 0)
+        { return FAILURE; }
+        break;
+      case UTHREAD_WAKE_EXIT:
+        if (!uthread_scheduler::validTid (source.arg)
+            || source.arg == running_thread->getId ())
+        { return FAILURE; }
+        break;
+      default:
+        return FAILURE;
+    }
+  }
+  return SUCCESS;
+}
+
+int uthread_wait_any (const wake_source *sources, int count)
+{
+  if (running_thread->getId () == 0)
+  {
+    err_lib_print (WAIT_MAIN_ERR);
+    return FAILURE;
+  }
+  block_signals_helper();
+  if (sourcesCheck (sources, count) == FAILURE)
   {
-    running_thread = nullptr;
     unblock_signals_helper();
-    jumpToThread(false, false);
+    err_lib_print (WAIT_ERR);
+    return FAILURE;
   }
-  else
+  if (cancelCheck (running_thread->getId ()) == FAILURE)
   {
-    removeFromReady (thread);
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  int fired = immediateSource (sources, count);
+  if (fired != NO_SOURCE)
+  {
+    unblock_signals_helper();
+    return fired;
   }
-  removefromSleeps(tid);
 
+  int tid = running_thread->getId ();
+  if (running_thread->isShared ())
+  {
+    waitSources[tid].assign (sources, sources + count);
+    sources = waitSources[tid].data ();
+  }
+  WaitState &wait = waits[tid];
+  wait = {sources, count, NO_SOURCE, 0, NO_SOURCE};
+  for (int i = 0; i < count; i++)
+  {
+    if (sources[i].type == UTHREAD_WAKE_TIMER
+        && (wait.timer == NO_SOURCE || sources[i].arg < sources[wait.timer].arg))
+    {
+      wait.timer = i;
+    }
+    if (sources[i].type == UTHREAD_WAKE_FD)
+    {
+      wait.polls++;
+    }
+  }
+  pollSources += wait.polls;
+  // The entry for the descriptor of uthread_idle_wait comes first.
+  pollFds.reserve (pollSources + 1);
+  pollOwners.reserve (pollSources + 1);
+  // The timeout is an ordinary sleep of a BLOCKED thread; sleepsQuantumUpdate
+  // fires the wait instead of leaving the thread blocked.
+  if (wait.timer != NO_SOURCE)
+  {
+    startSleep (tid, sources[wait.timer].arg);
+  }
+  while (wait.fired == NO_SOURCE && !cancelled[tid])
+  {
+    blockRunning ();
+    block_signals_helper();
+  }
+  if (wait.fired == NO_SOURCE)
+  {
+    // Cancelled; cancelThread already ended the wait.
+    unblock_signals_helper();
+    return cancelCheck (tid);
+  }
+  fired = wait.fired;
   unblock_signals_helper();
-  return SUCCESS;
+  return fired;
 }
 
-int uthread_block (int tid)
+int uthread_block_for (int num_quantums)
 {
-  if (tidCheck (tid, BLOCK_ERR, 1) == FAILURE)
+  if (num_quantums < 0)
+  {
+    err_lib_print (WAIT_ERR);
+    return FAILURE;
+  }
+  wake_source sources[] = {{UTHREAD_WAKE_RESUME, 0, 0},
+                           {UTHREAD_WAKE_TIMER, num_quantums, 0}};
+  int fired = uthread_wait_any (sources, 2);
+  if (fired == FAILURE)
   { return FAILURE; }
-  if (threadsVector[tid]->getState() == BLOCKED){return SUCCESS; }
+  return fired == 0 ? 1 : 0;
+}
+
+int uthread_cancel (int tid)
+{
   block_signals_helper();
+  if (tidCheck (tid, CANCEL_ERR, 1) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  cancelThread (tid);
+  unblock_signals_helper();
+  return SUCCESS;
+}
 
-  std::shared_ptr<Thread> &thread = threadsVector[tid];
+int uthread_is_cancelled ()
+{
+  return cancelled[running_thread->getId ()] ? 1 : 0;
+}
 
-  if (thread->isEqual (running_thread))
+int uthread_group_create ()
+{
+  block_signals_helper();
+  for (int gid = 0; gid < MAX_GROUP_NUM; gid++)
+  {
+    ThreadGroup &group = groups[gid];
+    if (!group.used)
+    {
+      group.used = true;
+      group.blocked = false;
+      group.cancelled = false;
+      group.quantums = 0;
+      group.cpu_nsecs = 0;
+      group.quota = QuotaState ();
+      unblock_signals_helper();
+      return gid;
+    }
+  }
+  unblock_signals_helper();
+  err_lib_print (GROUP_CREATE_ERR);
+  return FAILURE;
+}
+
+int uthread_spawn_in_group (int gid, thread_entry_point entry_point)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  int id = spawnThread (entry_point, uthread_scheduler::stack_size, gid);
+  unblock_signals_helper();
+  return id;
+}
+
+int uthread_group_block (int gid)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
   {
     unblock_signals_helper();
+    return FAILURE;
+  }
+  // Members leave the ready queue lazily, in parkBlockedGroups.
+  groups[gid].blocked = true;
+  if (running_thread->getGroup () == gid)
+  {
     int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
     if (ret_val == 0)
     {
-      jumpToThread(true, false);
+      jumpToThread(false, false);
     }
+    signalsRestoreAfterJump();
+    return SUCCESS;
   }
-  else
+  unblock_signals_helper();
+  return SUCCESS;
+}
+
+int uthread_group_resume (int gid)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
   {
-    thread->setState(BLOCKED);
-    removeFromReady(thread);
     unblock_signals_helper();
+    return FAILURE;
   }
-
+  groups[gid].blocked = false;
+  if (!groups[gid].quota.throttled)
+  {
+    readyQueue.spliceBack (groups[gid].parked);
+  }
+  unblock_signals_helper();
   return SUCCESS;
 }
 
-int uthread_resume (int tid)
+int uthread_group_terminate (int gid)
 {
-  if (tidCheck (tid, RESUME_ERR, 0) == FAILURE)
-  {
-    return FAILURE; }
   block_signals_helper();
-  std::shared_ptr<Thread> &thread = threadsVector[tid];
-
-  if (thread->getState () == BLOCKED)
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  ThreadGroup &group = groups[gid];
+  int self = NO_THREAD;
+  for (int tid : group.members)
   {
-    if (sleep_map.count(tid) ==0) {
-      readyQueue.push_back (thread);
+    threadsVector[tid]->setGroup (NO_GROUP);
+    if (tid == running_thread->getId ())
+    {
+      self = tid;
     }
-    thread->setState (READY);
+    else
+    {
+      releaseThread (tid);
+    }
+  }
+  group.members.clear ();
+  for (int waiter : group.waiters)
+  {
+    if (threadsVector[waiter] != nullptr)
+    {
+      resumeThread (threadsVector[waiter]);
+    }
+  }
+  group.waiters.clear ();
+  dropQuota (groupQuota (gid));
+  group.used = false;
+  group.blocked = false;
+  if (self != NO_THREAD)
+  {
+    // Doesn't return; the timer is still blocked, as uthread_terminate expects.
+    uthread_terminate (self);
   }
   unblock_signals_helper();
   return SUCCESS;
 }
 
-int uthread_sleep (int num_quantums)
+int uthread_group_wait (int gid)
 {
-
-  if (running_thread->getId() ==0){
-    err_lib_print (SLEEP_ERR);
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
     return FAILURE;
   }
-  block_signals_helper();
-  sleep_map[running_thread->getId()] = num_quantums;
+  int tid = running_thread->getId ();
+  if (running_thread->getGroup () == gid)
+  {
+    unblock_signals_helper();
+    err_lib_print (GROUP_WAIT_ERR);
+    return FAILURE;
+  }
+  while (groups[gid].used && !groups[gid].members.empty ())
+  {
+    if (tid == 0)
+    {
+      // The main thread can't block; it lets the members run between checks.
+      yieldTo (NO_THREAD);
+      block_signals_helper();
+      continue;
+    }
+    std::vector<int> &waiters = groups[gid].waiters;
+    // A waiter resumed early loops back here while still registered.
+    if (std::find (waiters.begin (), waiters.end (), tid) == waiters.end ())
+    {
+      waiters.push_back (tid);
+    }
+    blockRunning ();
+    block_signals_helper();
+  }
   unblock_signals_helper();
-  int ret_val = sigsetjmp(running_thread->env, ANOTHER_THREAD_JUMP);
-  if (ret_val == 0)
+  return SUCCESS;
+}
+
+int uthread_group_cancel (int gid)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
   {
-    running_thread = nullptr;
-    jumpToThread(false, true);
+    unblock_signals_helper();
+    return FAILURE;
   }
+  groups[gid].cancelled = true;
+  for (int tid : groups[gid].members)
+  {
+    cancelThread (tid);
+  }
+  unblock_signals_helper();
   return SUCCESS;
 }
 
-int uthread_get_total_quantums()
+int uthread_group_get_quantums (int gid)
 {
-  return totalQuantums;
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  int quantums = groups[gid].quantums;
+  unblock_signals_helper();
+  return quantums;
 }
 
-int uthread_get_quantums(int tid){
+long uthread_group_get_cpu_usecs (int gid)
+{
   block_signals_helper();
-  if (tidCheck (tid, QUANTUM_ERR , 0) == FAILURE)
-    { return FAILURE; }
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  long nsecs = groups[gid].cpu_nsecs;
+  if (uthread_scheduler::stats && running_thread->getGroup () == gid)
+  {
+    nsecs += cpuNow () - sliceStartCpu;
+  }
   unblock_signals_helper();
-  return threadsVector[tid]->getQuantums();
+  return nsecs / NSEC_PER_USEC;
+}
+
+int uthread_group_set_quota (int gid, int runtime_usecs, int period_usecs)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE
+      || quotaCheck (runtime_usecs, period_usecs) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  setQuota (groupQuota (gid), runtime_usecs, period_usecs);
+  unblock_signals_helper();
+  return SUCCESS;
 }
 
+long uthread_group_get_throttled_usecs (int gid)
+{
+  block_signals_helper();
+  if (groupCheck (gid) == FAILURE)
+  {
+    unblock_signals_helper();
+    return FAILURE;
+  }
+  long usecs = throttledUsecs (groupQuota (gid));
+  unblock_signals_helper();
+  return usecs;
+}
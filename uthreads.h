@@ -10,8 +10,49 @@
 
 #define MAX_THREAD_NUM 100 /* maximal number of threads */
 #define STACK_SIZE 4096 /* stack size per thread (in bytes) */
+#define MAX_GROUP_NUM MAX_THREAD_NUM /* maximal number of thread groups */
+#define MAX_BLOCKING_WORKERS 64 /* maximal number of OS threads running blocking calls */
+#define EDF_MAX_UTILIZATION 90 /* CPU share, in percent, admitted to deadline reservations */
 
 typedef void (*thread_entry_point)(void);
+typedef void (*posted_function)(void *arg);
+typedef long (*blocking_function)(void *arg);
+
+/* Wake source types of uthread_wait_any */
+#define UTHREAD_WAKE_RESUME 0 /* the waiting thread is resumed, with uthread_resume or uthread_resume_async */
+#define UTHREAD_WAKE_TIMER 1 /* arg quantums pass, counted as in uthread_sleep */
+#define UTHREAD_WAKE_FD 2 /* the file descriptor arg is ready for events, as in poll */
+#define UTHREAD_WAKE_EXIT 3 /* the thread with ID arg terminates */
+
+/** wake_source - one event a thread waits for in uthread_wait_any */
+typedef struct
+{
+  int type;
+  int arg;
+  short events;
+} wake_source;
+
+/* Modes of uthread_timer_create */
+#define UTHREAD_TIMER_ONESHOT 0 /* the callback runs once, and the timer is freed */
+#define UTHREAD_TIMER_PERIODIC 1 /* the callback runs every interval until the timer is cancelled */
+
+/* Thread states reported by uthread_snapshot */
+#define UTHREAD_STATE_RUNNING 0 /* the thread is running */
+#define UTHREAD_STATE_READY 1 /* the thread waits for the CPU */
+#define UTHREAD_STATE_BLOCKED 2 /* the thread is blocked, waits in uthread_wait_any, or its group is blocked */
+#define UTHREAD_STATE_SLEEPING 3 /* the thread sleeps */
+#define UTHREAD_STATE_THROTTLED 4 /* the thread is READY, but held back by its quota or its group's */
+
+/** uthread_info - the state of one thread, as copied by uthread_snapshot */
+typedef struct
+{
+  int tid;
+  int state;              /* a UTHREAD_STATE_* value */
+  int quantums;           /* as returned by uthread_get_quantums */
+  int sleep_quantums;     /* the quantums left of a sleep or wait timeout, 0 if none */
+  long idle_usecs;        /* the time since the thread last ran, or was spawned, 0 while it runs */
+  long busy_usecs;        /* the CPU time used since the thread last blocked, slept or yielded */
+} uthread_info;
 
 /* External interface */
 
@@ -24,6 +65,9 @@ typedef void (*thread_entry_point)(void);
  * You may assume that this function is called before any other thread library function, and that it is called
  * exactly once.
  * The input to the function is the length of a quantum in micro-seconds.
+ * It also starts the library's dispatcher thread (see uthread_post). The dispatcher has an ID of its own, past the
+ * MAX_THREAD_NUM IDs of the user's threads, so it can't be passed to the other functions, and its runs aren't counted
+ * as quantums.
  * It is an error to call this function with non-positive quantum_usecs.
  *
  * @return On success, return 0. On failure, return -1.
@@ -45,6 +89,33 @@ int uthread_init(int quantum_usecs);
 int uthread_spawn(thread_entry_point entry_point);
 
 
+/**
+ * @brief Creates a new thread like uthread_spawn, but with a stack of stack_size bytes instead of STACK_SIZE.
+ *
+ * Intended for runtimes layered on top of the library (e.g. the task pool) whose threads run deeper call chains.
+ * It is an error to call this function with a stack_size smaller than STACK_SIZE or not a multiple of 16.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_with_stack(thread_entry_point entry_point, int stack_size);
+
+
+/**
+ * @brief Creates a new thread like uthread_spawn, but running on a stack shared with the other threads created this
+ * way, of shared_stack_size bytes (basic_scheduler.h), instead of a stack of its own.
+ *
+ * Only the thread on the shared stack keeps its frames there. When another shared thread is switched in, the used
+ * part of the stack, from where the thread switched out to the top, is copied into a buffer sized to it, and the
+ * incoming thread's frames are copied back, so an idle thread takes about its actual stack depth instead of a whole
+ * stack. Switching to a shared thread costs a copy of both threads' frames unless it is already on the stack.
+ * The addresses of a shared thread's local variables are only valid while it runs: they must not be handed to
+ * other threads (e.g. a TaskGroup for the task pool's workers).
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_shared(thread_entry_point entry_point);
+
+
 /**
  * @brief Terminates the thread with ID tid and deletes it from all relevant control structures.
  *
@@ -63,7 +134,8 @@ int uthread_terminate(int tid);
  *
  * If no thread with ID tid exists it is considered as an error. In addition, it is an error to try blocking the
  * main thread (tid == 0). If a thread blocks itself, a scheduling decision should be made. Blocking a thread in
- * BLOCKED state has no effect and is not considered an error.
+ * BLOCKED state has no effect and is not considered an error. A thread that blocks itself after it was cancelled, or
+ * is cancelled while blocked, fails with errno set to ECANCELED (see uthread_cancel).
  *
  * @return On success, return 0. On failure, return -1.
 */
@@ -81,6 +153,42 @@ int uthread_block(int tid);
 int uthread_resume(int tid);
 
 
+/**
+ * @brief Turns the run-next slot on or off; it is off by default. While on, a thread resumed with uthread_resume
+ * runs next, ahead of the READY queue, instead of after every other READY thread, so it finds the data its waker
+ * just wrote still in the cache. The slot holds one thread: a later resume pushes the previous one to the end of the
+ * READY queue.
+ *
+ * The slot wins at most run_next_limit (basic_scheduler.h) scheduling decisions in a row before the front of the
+ * READY queue runs, so threads resuming each other can't starve the rest. Threads with a deadline keep their EDF
+ * order and don't use the slot.
+*/
+void uthread_set_run_next(int enable);
+
+
+/**
+ * @brief Moves the RUNNING thread to the end of the READY queue and makes a scheduling decision. Unlike uthread_sleep
+ * and uthread_block, the thread stays READY, and the main thread (tid == 0) may yield too. If no other thread is
+ * READY, the calling thread keeps running in the same quantum.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_yield();
+
+
+/**
+ * @brief Yields, as uthread_yield does, directly to the thread with ID tid: if it is READY it runs next, ahead of the
+ * READY queue, for the remainder of the caller's quantum. The switch still counts as a new quantum. If the thread
+ * isn't READY (it is BLOCKED, sleeping or in a blocked group), the next thread is chosen as usual.
+ *
+ * Two threads handing the CPU back and forth this way take one context switch per handoff, however many other
+ * threads are READY. It is an error if no thread with ID tid exists.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid);
+
+
 /**
  * @brief Blocks the RUNNING thread for num_quantums quantums.
  *
@@ -90,7 +198,8 @@ int uthread_resume(int tid);
  * at the same time, the order in which they're added to the end of the READY queue doesn't matter.
  * The number of quantums refers to the number of times a new quantum starts, regardless of the reason. Specifically,
  * the quantum of the thread which has made the call to uthread_sleep isn’t counted.
- * It is considered an error if the main thread (tid == 0) calls this function.
+ * It is considered an error if the main thread (tid == 0) calls this function. A cancelled thread doesn't sleep, or
+ * stops sleeping, and fails with errno set to ECANCELED.
  *
  * @return On success, return 0. On failure, return -1.
 */
@@ -128,4 +237,403 @@ int uthread_get_total_quantums();
 int uthread_get_quantums(int tid);
 
 
+/**
+ * @brief Copies the state of up to n threads into buf, in thread ID order, main thread first. The copy is taken with
+ * the timer blocked, in one pass over the thread table, so it is consistent and cheap enough to poll.
+ *
+ * idle_usecs and busy_usecs are measured at every switch, only when the scheduler is configured with stats
+ * (basic_scheduler.h); otherwise they are 0. It is an error to call this function with a negative n.
+ *
+ * @return On success, return the number of threads copied. On failure, return -1.
+*/
+int uthread_snapshot(uthread_info *buf, int n);
+
+
+/**
+ * @brief Sets the length of the quantums of the thread with ID tid to usecs microseconds; 0 restores the default
+ * quantum, the one passed to uthread_init or the adaptive quantum.
+ *
+ * Long slices suit throughput-oriented threads, short ones responsive threads. The timer is armed with the slice of
+ * each thread as it starts running; if tid is the RUNNING thread, its current quantum keeps its length. A quantum is
+ * still counted once per scheduling, whatever its length, so uthread_get_quantums and uthread_sleep are unaffected.
+ * It is an error to call this function with a negative usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_timeslice(int tid, int usecs);
+
+
+/**
+ * @brief Returns the length of the quantums of the thread with ID tid.
+ *
+ * @return On success, return the time slice in microseconds. On failure, return -1.
+*/
+int uthread_get_timeslice(int tid);
+
+
+/**
+ * @brief Sets whether the thread with ID tid carries unused time over. When enabled, a thread that blocks or sleeps
+ * before its quantum ends gets the unused time, up to one time slice, added to its next quantum. Disabled by default.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_carry_over(int tid, int enable);
+
+
+/**
+ * @brief Turns on adaptive tuning of the default quantum, used by the threads without their own time slice, within
+ * min_usecs..max_usecs. max_usecs == 0 turns tuning off and restores the quantum passed to uthread_init.
+ *
+ * The scheduler measures the cost of every scheduling point, from the timer signal until a thread runs again, and
+ * every few quantums counts the READY threads. The quantum is set as short as max_delay_usecs / READY threads, so a
+ * READY thread waits at most about max_delay_usecs (0 means no delay target, which keeps the quantum at max_usecs),
+ * but long enough that switches take at most overhead_permille thousandths of the CPU (10 for 1%); the overhead
+ * target wins if they conflict. Quantums are still counted once per scheduling, so uthread_get_total_quantums and
+ * uthread_sleep keep their meaning; only the length of a quantum changes.
+ * It is an error if min_usecs isn't positive, max_usecs < min_usecs, overhead_permille isn't in 1..1000, or
+ * max_delay_usecs is negative.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_adaptive_quantum(int min_usecs, int max_usecs, int overhead_permille, int max_delay_usecs);
+
+
+/**
+ * @brief Returns the current default quantum: the one passed to uthread_init, or the adaptive quantum.
+ *
+ * @return The quantum in microseconds.
+*/
+int uthread_get_quantum_usecs();
+
+
+/**
+ * @brief Schedules the thread with ID tid earliest-deadline-first: each of its jobs, from the time it becomes READY
+ * until it blocks, sleeps or terminates, should complete within relative_usecs microseconds. 0 returns the thread
+ * to round-robin.
+ *
+ * READY deadline threads always run before round-robin threads, the one with the earliest deadline first, and are
+ * picked at every scheduling point. A job that completes after its deadline counts as a miss, and a job still running
+ * past its deadline is demoted: it runs round-robin until it blocks, sleeps or terminates, so an overrunning job
+ * doesn't starve the other threads. A plain deadline isn't subject to admission control; use uthread_set_reservation for guarantees. Replaces any reservation of the thread.
+ * It is an error to call this function for the main thread or with a negative relative_usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_deadline(int tid, int relative_usecs);
+
+
+/**
+ * @brief Reserves runtime_usecs microseconds of CPU every period_usecs microseconds for the thread with ID tid, each
+ * job due deadline_usecs microseconds after its release (0 for the end of the period), scheduled as by
+ * uthread_set_deadline. The thread calls uthread_wait_next_period when it completes a job.
+ * The reservation is enforced like a quota (see uthread_set_quota): once a job used runtime_usecs of CPU time, the
+ * thread is throttled until the period ends, and each release of a job starts a period with the full runtime. The
+ * runtime is enforced only when the scheduler measures CPU time (stats in basic_scheduler.h).
+ *
+ * Admission control rejects the reservation if the sum of runtime / deadline over all reservations would exceed
+ * EDF_MAX_UTILIZATION percent, the rest of the CPU being left to round-robin threads. It is an error to call this
+ * function for the main thread, or unless 0 < runtime_usecs <= deadline_usecs <= period_usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_reservation(int tid, int runtime_usecs, int period_usecs, int deadline_usecs);
+
+
+/**
+ * @brief Completes the current job of the RUNNING thread, which must have a reservation, and blocks it until its next
+ * period starts. Releases are checked at every scheduling point. If the next period already started, its job is
+ * released immediately. A cancelled thread stops waiting and fails with errno set to ECANCELED.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_wait_next_period();
+
+
+/**
+ * @brief Returns the number of jobs of the thread with ID tid that completed after their deadline.
+ *
+ * @return On success, return the number of misses. On failure, return -1.
+*/
+int uthread_get_deadline_misses(int tid);
+
+
+/**
+ * @brief Caps the CPU time of the thread with ID tid to runtime_usecs microseconds every period_usecs microseconds.
+ * runtime_usecs == 0 removes the cap.
+ *
+ * CPU time is charged at every switch. Once the thread used up its runtime it is throttled: it stays READY but isn't
+ * scheduled until its period ends and the quota is refilled. Its quantums are cut short to the runtime left, so it
+ * overruns by at most a timer tick; an overrun is paid back from the next period. Only throttled quotas are visited
+ * at refill, so quotas cost nothing while they have runtime left. A thread in a group with its own quota
+ * (uthread_group_set_quota) is held back by whichever runs out first.
+ * It is an error to call this function for the main thread, with a negative runtime_usecs or one that doesn't fit in
+ * a positive period_usecs, or if the scheduler doesn't measure CPU time (stats in basic_scheduler.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_quota(int tid, int runtime_usecs, int period_usecs);
+
+
+/**
+ * @brief Returns the total time the thread with ID tid spent throttled by its quota, in microseconds.
+ *
+ * @return On success, return the throttled time. On failure, return -1.
+*/
+long uthread_get_throttled_usecs(int tid);
+
+
+/**
+ * @brief Posts a call of fn(arg) to the scheduler. Unlike the rest of the interface, this function may be called
+ * from any OS thread, including threads that don't belong to the library.
+ *
+ * The call is pushed to a lock-free queue. The next scheduling point wakes the library's dispatcher thread, which
+ * drains the queue and runs the call in order with the other posted calls. fn may call any library function.
+ * Posting allocates, with the timer signal blocked when called from a thread of the library, so such a thread needs
+ * a stack larger than STACK_SIZE (see uthread_spawn_with_stack).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_post(posted_function fn, void *arg);
+
+
+/**
+ * @brief Creates a timer that calls callback(arg) interval_usecs microseconds from now, once or every interval_usecs
+ * microseconds depending on mode (UTHREAD_TIMER_ONESHOT or UTHREAD_TIMER_PERIODIC), without a thread of its own.
+ *
+ * Timers are kept by expiration time; each scheduling point checks the earliest one and wakes up the dispatcher
+ * thread once it is due, and uthread_idle_wait wakes up for them, so a timer costs nothing until it expires and fires
+ * within about a quantum of it. The dispatcher runs expired callbacks like posted calls, in order (see
+ * uthread_post), and they may call any library function. A periodic timer keeps its phase; periods missed before the
+ * dispatcher ran are skipped. It is an error to call this
+ * function with a non-positive interval_usecs, a null callback or an unknown mode.
+ *
+ * @return On success, return the ID of the timer. On failure, return -1.
+*/
+int uthread_timer_create(int interval_usecs, posted_function callback, void *arg, int mode);
+
+
+/**
+ * @brief Cancels the timer with ID timer_id, releasing its ID. A callback that already expired still runs. It is an
+ * error if no such timer exists; a one-shot timer stops existing once it expires.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_timer_cancel(int timer_id);
+
+
+/**
+ * @brief Asks the scheduler to resume the thread with ID tid, as uthread_resume does. May be called from any OS
+ * thread.
+ *
+ * The request is applied by the dispatcher thread (see uthread_post), which the next scheduling point wakes; if by
+ * then no thread with ID tid exists, or it isn't BLOCKED, the request has no effect.
+ *
+ * @return On success, return 0. On failure (tid out of range), return -1.
+*/
+int uthread_resume_async(int tid);
+
+
+/**
+ * @brief Waits for work posted by other OS threads when no other thread is READY.
+ *
+ * Intended for the idle loop of the main thread. If no thread is READY, the OS thread sleeps on an eventfd until
+ * uthread_post or uthread_resume_async is called, a file descriptor waited for in uthread_wait_any becomes ready, or
+ * timeout_msecs passes (a negative value waits forever), waking up early for the next timer of uthread_timer_create.
+ * In any case the posted work is then applied, and the callbacks of the expired timers run on the dispatcher thread
+ * before this function returns.
+ *
+ * @return 1 if posted work was applied, a timer fired or a thread became READY, 0 otherwise.
+*/
+int uthread_idle_wait(int timeout_msecs);
+
+
+/**
+ * @brief Blocks the RUNNING thread until it is resumed, or until num_quantums quantums pass, counted as in
+ * uthread_sleep, whichever comes first.
+ *
+ * The timeout is kept with the sleeping threads, so it costs no extra thread. It is considered an error if the main
+ * thread (tid == 0) calls this function, or if num_quantums is negative.
+ *
+ * @return 1 if the thread was resumed, 0 if the timeout passed. On failure, return -1.
+*/
+int uthread_block_for(int num_quantums);
+
+
+/**
+ * @brief Cancels the thread with ID tid. Cancellation is cooperative: the thread isn't terminated, but from now on
+ * its blocking operations (uthread_sleep, uthread_block of itself, uthread_block_for, uthread_wait_any,
+ * uthread_blocking_call and uthread_wait_next_period) fail with errno set to ECANCELED, so it can unwind and release
+ * its resources. If the thread is in one of them, it is moved to the READY queue right away. Code that runs without
+ * blocking should poll uthread_is_cancelled.
+ *
+ * Joins (uthread_group_wait, task_sync) aren't interrupted, since the work they wait for must still finish.
+ * It is an error to cancel the main thread (tid == 0) or a thread that doesn't exist. Cancelling a thread again has
+ * no effect.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_cancel(int tid);
+
+
+/**
+ * @brief Returns whether the RUNNING thread was cancelled, with uthread_cancel or uthread_group_cancel.
+ *
+ * @return 1 if the thread was cancelled, 0 otherwise.
+*/
+int uthread_is_cancelled();
+
+
+/**
+ * @brief Blocks the RUNNING thread until one of count wake sources fires:
+ *  UTHREAD_WAKE_RESUME - the thread is resumed. Without this source, uthread_resume doesn't end the wait.
+ *  UTHREAD_WAKE_TIMER - arg quantums pass, counted as in uthread_sleep.
+ *  UTHREAD_WAKE_FD - the file descriptor arg is ready for events (POLLIN, POLLOUT...). Descriptors are polled at
+ *    every scheduling point, and by uthread_idle_wait while no thread is READY.
+ *  UTHREAD_WAKE_EXIT - the thread with ID arg terminates. A thread that doesn't exist fires immediately.
+ *
+ * If a source is already satisfied, the function returns without blocking. sources must stay valid until the
+ * function returns. It is considered an error if the main thread (tid == 0) calls this function, if count isn't
+ * positive, or if a source is invalid. A cancelled thread stops waiting and fails with errno set to ECANCELED.
+ *
+ * @return On success, return the index in sources of the source that fired. On failure, return -1.
+*/
+int uthread_wait_any(const wake_source *sources, int count);
+
+
+/**
+ * @brief Calls fn(arg) on an internal pool of OS threads, so a call that blocks in the kernel (fsync, getaddrinfo,
+ * a blocking third-party library...) doesn't stall the other threads.
+ *
+ * The calling thread is BLOCKED until the call completes and is then resumed through the READY queue, as
+ * uthread_resume does; uthread_resume doesn't end the wait early. Completion is delivered through the injection queue
+ * drained by the dispatcher thread (see uthread_post), without signals. fn runs on a foreign OS thread, so it must not call the
+ * library, other than uthread_post and uthread_resume_async. The main thread keeps running the other threads while
+ * it waits, as uthread_idle_wait does. If the calling thread is cancelled, it stops waiting and fails with errno set
+ * to ECANCELED; the call itself can't be stopped, so it still runs to completion on its worker.
+ *
+ * @return fn's return value, with errno set as fn left it. On failure (fn is null, or the thread was cancelled),
+ * return -1.
+*/
+long uthread_blocking_call(blocking_function fn, void *arg);
+
+
+/**
+ * @brief Sets the number of OS threads running blocking calls, 4 by default. The pool only grows: a value below the
+ * current size has no effect. Workers are started by the first uthread_blocking_call.
+ *
+ * It is an error to call this function with a value that isn't in 1..MAX_BLOCKING_WORKERS.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_blocking_pool_size(int workers);
+
+
+/**
+ * @brief Creates an empty thread group.
+ *
+ * Groups let a set of threads be blocked, resumed and terminated with a single call. A group exists until it is
+ * terminated with uthread_group_terminate, even after all its members exited. The main thread can't join a group.
+ *
+ * @return On success, return the ID of the created group. On failure (MAX_GROUP_NUM groups exist), return -1.
+*/
+int uthread_group_create();
+
+
+/**
+ * @brief Creates a new thread, as uthread_spawn does, as a member of the group with ID gid.
+ *
+ * If the group is blocked, the new thread is READY but doesn't run until the group is resumed.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_in_group(int gid, thread_entry_point entry_point);
+
+
+/**
+ * @brief Blocks the group with ID gid: none of its members runs until uthread_group_resume is called.
+ *
+ * Takes O(1): the group's READY members are set aside as they reach the front of the READY queue. Members keep
+ * their own state, so a member that is also BLOCKED still needs uthread_resume. If the calling thread is a member, a
+ * scheduling decision is made. Blocking a blocked group has no effect.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_block(int gid);
+
+
+/**
+ * @brief Resumes the group with ID gid. Its READY members are moved back to the end of the READY queue, in order,
+ * in one O(1) operation. Resuming a group that isn't blocked has no effect.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_resume(int gid);
+
+
+/**
+ * @brief Terminates all the members of the group with ID gid and deletes the group, releasing its ID.
+ *
+ * Threads waiting for the group are resumed. If the calling thread is a member, it is terminated last and the
+ * function does not return.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_terminate(int gid);
+
+
+/**
+ * @brief Blocks the calling thread until the group with ID gid has no members left, or is terminated.
+ *
+ * It is an error for a member to wait for its own group. The main thread, which can't block, keeps polling instead.
+ * The wait isn't interrupted if the calling thread is cancelled.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_wait(int gid);
+
+
+/**
+ * @brief Cancels every member of the group with ID gid, as uthread_cancel does. Threads spawned into the group
+ * afterwards start cancelled.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_cancel(int gid);
+
+
+/**
+ * @brief Returns the total number of quantums started by the members of the group with ID gid, including members
+ * that already terminated.
+ *
+ * @return On success, return the number of quantums. On failure, return -1.
+*/
+int uthread_group_get_quantums(int gid);
+
+
+/**
+ * @brief Returns the CPU time used by the members of the group with ID gid, including members that already
+ * terminated, in microseconds.
+ *
+ * @return On success, return the CPU time. On failure, return -1.
+*/
+long uthread_group_get_cpu_usecs(int gid);
+
+
+/**
+ * @brief Caps the CPU time used by all the members of the group with ID gid together, as uthread_set_quota does for
+ * one thread. While the group is throttled its READY members are held back, as if the group were blocked.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_group_set_quota(int gid, int runtime_usecs, int period_usecs);
+
+
+/**
+ * @brief Returns the total time the group with ID gid spent throttled by its quota, in microseconds.
+ *
+ * @return On success, return the throttled time. On failure, return -1.
+*/
+long uthread_group_get_throttled_usecs(int gid);
+
+
 #endif
@@ -0,0 +1,94 @@
+/*
+ * Internal interface of the uthreads library.
+ * Shared between uthreads.cpp and the modules built on top of it; not part of the public API.
+ *
+ * Heap rule: the timer signal may preempt a thread inside malloc, and the heap isn't reentrant. So the library only
+ * allocates or frees with the timer signal blocked, and never at a scheduling point reached from the signal
+ * handler: the switch path works on storage allocated beforehand, and heap work it finds is handed to a thread.
+ */
+
+#ifndef _UTHREADS_INTERNAL_H
+#define _UTHREADS_INTERNAL_H
+
+#include <string>
+#include "uthreads.h"
+#include "basic_scheduler.h"
+
+class Arena;
+
+#define SHARED_STACK 0 /* stack size of spawnThread for a thread on the shared stack */
+
+/** uthread_scheduler - the scheduler configuration of the uthread_* API */
+typedef basic_scheduler<default_scheduler_config> uthread_scheduler;
+
+/**
+block_signals_helper - blocks the timer signal, so the running thread can't be preempted
+@return EXIT_SUCCESS if the signals were successfully blocked, FAILURE otherwise
+*/
+int block_signals_helper();
+
+/**
+signalsBlocked - checks if the timer signal is blocked by block_signals_helper,
+ so code that may run inside a blocked region can leave the mask as it found it.
+ The helpers don't nest: unblock_signals_helper always re-enables the signal.
+@return true if the signal is blocked, false otherwise
+*/
+bool signalsBlocked ();
+
+/**
+unblock_signals_helper - re-enables the timer signal
+@return EXIT_SUCCESS if the signals were successfully unblocked, FAILURE otherwise
+*/
+int unblock_signals_helper();
+
+/**
+err_lib_print - prints an error message for a library error
+@param err_text: the text of the error message
+@return void
+*/
+void err_lib_print (std::string err_text);
+
+/**
+err_sys_print - prints an error message for a system error and exits the program
+@param err_text: the text of the error message
+@return void
+*/
+void err_sys_print (std::string err_text);
+
+/**
+spawnThread - creates a thread in the group gid, or in no group if gid is -1.
+ Called with the timer signal blocked, which stays blocked, so the caller can
+ set the thread up before it first runs.
+@param entry_point: the function the thread runs
+@param stack_size: the size of the thread's stack in bytes, or SHARED_STACK
+@param gid: the group of the new thread
+@return the ID of the new thread, or FAILURE if the entry point is null or the
+ thread table is full
+*/
+int spawnThread (thread_entry_point entry_point, int stack_size, int gid);
+
+/**
+blockRunning - blocks the running thread until it is resumed. Unlike
+ uthread_block, it isn't interrupted by cancellation. Called with the timer
+ signal blocked; returns with it enabled.
+@return void
+*/
+void blockRunning ();
+
+/**
+resumeBlocked - resumes a thread like uthread_resume, for callers that are
+ inside a blocked region: uthread_resume re-enables the timer on return.
+ Called with the timer signal blocked, which stays blocked.
+@param tid: the ID of the thread
+@return void
+*/
+void resumeBlocked (int tid);
+
+/**
+threadArena - gets the arena of a thread
+@param tid: the ID of the thread
+@return the thread's arena, or nullptr if no thread with ID tid exists
+*/
+Arena *threadArena (int tid);
+
+#endif
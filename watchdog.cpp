@@ -0,0 +1,155 @@
+/** ~~~~~~~~~~~~~~~~~~ Includes ~~~~~~~~~~~ **/
+#include "uthreads.h"
+#include "uthreads_internal.h"
+#include "watchdog.h"
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+#define FAILURE -1
+#define SUCCESS 0
+#define NO_THREAD -1
+#define NO_GROUP -1
+#define WATCHDOG_ERR "Watchdog error, invalid thresholds or null callback!"
+
+/** watchdogTid - the ID of the watchdog thread, or NO_THREAD */
+static int watchdogTid = NO_THREAD;
+
+/** starveUsecs, monopolyUsecs, watchdogCallback - the parameters of the running watchdog */
+static int starveUsecs = 0;
+static int monopolyUsecs = 0;
+static watchdog_callback watchdogCallback = nullptr;
+
+/** reported - whether each thread was reported for each reason in its current episode */
+static bool reported[MAX_THREAD_NUM][2] = {};
+
+/** ~~~~~~~~~~~~~~~~~~ Helper functions ~~~~~~~~~~~ **/
+
+/**
+checkPeriod - the number of quantums the watchdog sleeps between checks
+@return half the smallest threshold, in the watchdog's quantums, and at least 1
+*/
+static int checkPeriod ()
+{
+  int threshold = starveUsecs;
+  if (threshold == 0 || (monopolyUsecs != 0 && monopolyUsecs < threshold))
+  {
+    threshold = monopolyUsecs;
+  }
+  int quantums = threshold / 2 / uthread_get_timeslice (uthread_get_tid ());
+  return quantums > 0 ? quantums : 1;
+}
+
+/**
+report - calls the callback for a thread whose condition holds, once per
+ episode, and ends the episode once the condition cleared
+@param callback: the callback
+@param tid: the ID of the thread
+@param reason: the UTHREAD_WATCHDOG_* reason checked
+@param holds: whether the condition holds
+@param usecs: the measure passed to the callback
+@return void
+*/
+static void report (watchdog_callback callback, int tid, int reason, bool holds,
+                    long usecs)
+{
+  if (!holds)
+  {
+    reported[tid][reason] = false;
+    return;
+  }
+  if (reported[tid][reason])
+  { return; }
+  reported[tid][reason] = true;
+  callback (tid, reason, usecs);
+}
+
+/**
+watchdogThread - the entry point of the watchdog thread: checks a snapshot of
+ the threads, then sleeps, until the watchdog is stopped
+@return never returns
+*/
+static void watchdogThread ()
+{
+  static uthread_info threads[MAX_THREAD_NUM];
+  bool seen[MAX_THREAD_NUM];
+  for (;;)
+  {
+    block_signals_helper ();
+    // Copied, since the callback may stop or restart the watchdog.
+    watchdog_callback callback = watchdogCallback;
+    int starve_usecs = starveUsecs;
+    int monopoly_usecs = monopolyUsecs;
+    if (callback == nullptr)
+    {
+      watchdogTid = NO_THREAD;
+      // Doesn't return; the timer is still blocked, as uthread_terminate expects.
+      uthread_terminate (uthread_get_tid ());
+    }
+    unblock_signals_helper ();
+
+    int count = uthread_snapshot (threads, MAX_THREAD_NUM);
+    for (int tid = 0; tid < MAX_THREAD_NUM; tid++)
+    {
+      seen[tid] = false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+      const uthread_info &info = threads[i];
+      seen[info.tid] = true;
+      if (starve_usecs > 0)
+      {
+        report (callback, info.tid, UTHREAD_WATCHDOG_STARVED,
+                info.state == UTHREAD_STATE_READY && info.idle_usecs > starve_usecs,
+                info.idle_usecs);
+      }
+      if (monopoly_usecs > 0 && info.state != UTHREAD_STATE_RUNNING)
+      {
+        report (callback, info.tid, UTHREAD_WATCHDOG_MONOPOLY,
+                info.busy_usecs > monopoly_usecs, info.busy_usecs);
+      }
+    }
+    // A terminated thread's ID may be reused by a new thread.
+    for (int tid = 0; tid < MAX_THREAD_NUM; tid++)
+    {
+      if (!seen[tid])
+      {
+        reported[tid][UTHREAD_WATCHDOG_STARVED] = false;
+        reported[tid][UTHREAD_WATCHDOG_MONOPOLY] = false;
+      }
+    }
+    uthread_sleep (checkPeriod ());
+  }
+}
+
+/** ~~~~~~~~~~~~~~~~~~ Library functions ~~~~~~~~~~~ **/
+
+int uthread_watchdog_start (int starve_usecs, int monopoly_usecs, watchdog_callback callback)
+{
+  if (starve_usecs < 0 || monopoly_usecs < 0
+      || (starve_usecs == 0 && monopoly_usecs == 0) || callback == nullptr)
+  {
+    err_lib_print (WATCHDOG_ERR);
+    return FAILURE;
+  }
+  block_signals_helper ();
+  starveUsecs = starve_usecs;
+  monopolyUsecs = monopoly_usecs;
+  watchdogCallback = callback;
+  if (watchdogTid == NO_THREAD)
+  {
+    watchdogTid = spawnThread (watchdogThread, WATCHDOG_STACK_SIZE, NO_GROUP);
+    if (watchdogTid == FAILURE)
+    {
+      watchdogTid = NO_THREAD;
+      watchdogCallback = nullptr;
+      unblock_signals_helper ();
+      return FAILURE;
+    }
+  }
+  unblock_signals_helper ();
+  return SUCCESS;
+}
+
+void uthread_watchdog_stop ()
+{
+  watchdogCallback = nullptr;
+}
@@ -0,0 +1,42 @@
+/*
+ * Starvation and monopolization watchdog for uthreads.
+ *
+ * The watchdog is an internal thread that wakes up periodically, takes a uthread_snapshot and reports through a user
+ * callback the threads that are READY but haven't run for too long (starved), and the threads that used too much
+ * CPU time without ever blocking, sleeping or yielding (monopolizing). Each thread is reported once per episode: it
+ * is reported again only after the condition cleared. Both measures need the scheduler's stats (basic_scheduler.h).
+ */
+
+#ifndef _WATCHDOG_H
+#define _WATCHDOG_H
+
+/** ~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~ **/
+
+#define WATCHDOG_STACK_SIZE 65536 /* stack size of the watchdog thread (in bytes) */
+
+/* Reasons passed to a watchdog_callback */
+#define UTHREAD_WATCHDOG_STARVED 0 /* the thread was READY and didn't run for usecs */
+#define UTHREAD_WATCHDOG_MONOPOLY 1 /* the thread used usecs of CPU time without blocking */
+
+typedef void (*watchdog_callback)(int tid, int reason, long usecs);
+
+/* External interface */
+
+/**
+ * @brief Starts the watchdog, or changes its parameters if it runs. A threshold of 0 turns its check off.
+ *
+ * The watchdog thread takes a slot of the thread table and checks about twice per smallest threshold, but at most
+ * once per quantum. callback runs on the watchdog thread, so it may call any library function, but it delays the
+ * next check while it runs.
+ * It is an error to call this function with a negative threshold, with both thresholds 0, or with a null callback.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_watchdog_start (int starve_usecs, int monopoly_usecs, watchdog_callback callback);
+
+/**
+ * @brief Stops the watchdog. Its thread terminates the next time it wakes up.
+*/
+void uthread_watchdog_stop ();
+
+#endif